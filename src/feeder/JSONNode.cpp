@@ -6,14 +6,14 @@ JSONNode::JSONNode() {}
 // JSONNode copy constructor
 JSONNode::JSONNode(const JSONNode &t) {
 	node_id = t.node_id;
-	node_name = t.node_name;
+	node_name_id = t.node_name_id;
 	node_type = t.node_type;
 	is_cpu_op = t.is_cpu_op;
 	runtime = t.runtime;
 	data_deps = t.data_deps;	
 	dep_unresolved_parent_ids_json = t.dep_unresolved_parent_ids_json;
-	children_vec_json = t.children_vec_json;
-	children_set_json = t.children_set_json;
+	children_ids_json = t.children_ids_json;
+	children_id_set_json = t.children_id_set_json;
 	if (node_type == 5 || node_type == 6 || node_type == 7) {
 		tensor_size = t.tensor_size;
 		comm_type = t.comm_type;
@@ -36,7 +36,7 @@ JSONNode::JSONNode(json data, int32_t id) {
 				std::cerr << "node_id not specified in ET" << std::endl;
 			}
 			try {
-				node_name = data["workload_graph"][id]["Name"];
+				setName(data["workload_graph"][id]["Name"]);
 			}
 			catch (...) {
 				std::cerr << "node_name not specified in ET" << std::endl;
@@ -139,17 +139,17 @@ void JSONNode::setDepUnresolvedParentIDs(std::vector<int64_t> const& dep_unresol
 }
 
 // Add child
-void JSONNode::addChild(JSONNode node) {
+void JSONNode::addChild(int64_t node_id) {
 	 // Avoid adding the same child node multiple times
 	// addChild is called multiple times to resolve dependencies
-	if (children_set_json.find(node) != children_set_json.end()) {
+	if (children_id_set_json.find(node_id) != children_id_set_json.end()) {
 		return;
 	}
-	children_vec_json.emplace_back(node);
-	children_set_json.emplace(node);
+	children_ids_json.emplace_back(node_id);
+	children_id_set_json.emplace(node_id);
 }
 
-// Get children vector
-std::vector<JSONNode> JSONNode::getChildren() {
-  return children_vec_json;
+// Get children ids
+std::vector<int64_t> JSONNode::getChildren() {
+  return children_ids_json;
 }
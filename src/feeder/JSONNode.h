@@ -7,51 +7,60 @@
 #include <queue>
 #include <functional>
 #include <set>
+#include <unordered_set>
+
+#include "et_feeder/string_pool.h"
 
 using json = nlohmann::json;
 
 class JSONNode {
 	public:
-		int64_t node_id;
-		std::string node_name;
-		int node_type;
-		bool is_cpu_op;
-		int64_t runtime;
-		int64_t num_ops;
-		int64_t tensor_size;
-		int64_t comm_type;
-		int32_t comm_priority;
-		int64_t comm_size;
-		int32_t comm_src;
-		int32_t comm_dst;
-		int32_t comm_tag;
-		int32_t involved_dim_size;
+		int64_t node_id = -1;
+		// Interned name id; the bytes live in the shared StringPool so
+		// repeated operator names are stored once per process
+		uint32_t node_name_id = 0;
+		int node_type = 0;
+		bool is_cpu_op = false;
+		int64_t runtime = 0;
+		int64_t num_ops = 0;
+		int64_t tensor_size = 0;
+		int64_t comm_type = 0;
+		int32_t comm_priority = 0;
+		int64_t comm_size = 0;
+		int32_t comm_src = 0;
+		int32_t comm_dst = 0;
+		int32_t comm_tag = 0;
+		int32_t involved_dim_size = 0;
 		std::vector<bool> involved_dim;
 		std::vector<int64_t> data_deps{};
 		std::vector<int64_t> dep_unresolved_parent_ids_json{};
-		std::vector<JSONNode> children_vec_json{};
+		// Children are held as ids into the owning dependency graph,
+		// mirroring how ETFeederNode holds shared_ptr children, so
+		// linking never deep-copies a recursive structure
+		std::vector<int64_t> children_ids_json{};
+		std::unordered_set<int64_t> children_id_set_json{};
 
-		// Compare function for set
-		struct CompareJSONNodesLT {
-			bool operator()(const JSONNode& a, const JSONNode& b) const {
-				return a.node_id < b.node_id;
-			}
-		};
-		std::set<JSONNode, CompareJSONNodesLT> children_set_json{};
-		
 		JSONNode();
 		JSONNode(const JSONNode &t);
+		JSONNode(JSONNode&& t) = default;
 		JSONNode(json data, int32_t id);
 		void addDepUnresolvedParentID(int64_t node_id);
 		std::vector<int64_t> getDepUnresolvedParentIDs();
 		void setDepUnresolvedParentIDs(std::vector<int64_t> const& dep_unresolved_parent_ids);
-		void addChild(JSONNode node);
-		std::vector<JSONNode> getChildren();
+		void addChild(int64_t node_id);
+		std::vector<int64_t> getChildren();
+
+		void setName(const std::string& name) {
+			node_name_id = Chakra::StringPool::instance().intern(name);
+		}
+		const std::string& name() const {
+			return Chakra::StringPool::instance().resolve(node_name_id);
+		}
 
 		// Define the == operator for comparison 
 		bool operator==(const JSONNode& other) const {
 			return node_id == other.node_id &&
-				node_name == other.node_name &&
+				node_name_id == other.node_name_id &&
 				node_type == other.node_type &&
 				is_cpu_op == other.is_cpu_op &&
 				runtime == other.runtime &&
@@ -67,8 +76,8 @@ class JSONNode {
 				involved_dim == other.involved_dim &&
 				data_deps == other.data_deps &&
 				dep_unresolved_parent_ids_json == other.dep_unresolved_parent_ids_json &&
-				children_vec_json == other.children_vec_json &&
-				children_set_json == other.children_set_json;
+				children_ids_json == other.children_ids_json &&
+				children_id_set_json == other.children_id_set_json;
 		}
 
 		// Overload the assignment operator
@@ -76,7 +85,7 @@ class JSONNode {
 			if (this != &other) {
 				// Copy all member variables
 				node_id = other.node_id;
-				node_name = other.node_name;
+				node_name_id = other.node_name_id;
 				node_type = other.node_type;
 				is_cpu_op = other.is_cpu_op;
 				runtime = other.runtime;
@@ -92,11 +101,14 @@ class JSONNode {
 				involved_dim = other.involved_dim;
 				data_deps = other.data_deps;
 				dep_unresolved_parent_ids_json = other.dep_unresolved_parent_ids_json;
-				children_vec_json = other.children_vec_json;
-				children_set_json = other.children_set_json;
+				children_ids_json = other.children_ids_json;
+				children_id_set_json = other.children_id_set_json;
 			}
 			return *this;
 		}
+
+		// Move assignment steals the vectors instead of copying them
+		JSONNode& operator=(JSONNode&& other) = default;
 };
 
 // Define a custom hash function for unordered set
@@ -105,7 +117,9 @@ namespace std {
 	struct hash<JSONNode> {
 		std::size_t operator()(const JSONNode& node) const {
 			std::size_t h1 = std::hash<int64_t>()(node.node_id);
-			std::size_t h2 = std::hash<std::string>()(node.node_name);
+			// The interned id hashes in O(1); the name bytes are never
+			// re-hashed per container operation
+			std::size_t h2 = std::hash<uint32_t>()(node.node_name_id);
 			std::size_t h3 = std::hash<int>()(node.node_type);
 			std::size_t h4 = std::hash<bool>()(node.is_cpu_op);
 			std::size_t h5 = std::hash<int64_t>()(node.runtime);
@@ -131,8 +145,8 @@ struct CompareJSONNodesGT : public std::binary_function<
                           JSONNode,
                           bool> {
   bool operator()(
-      const JSONNode lhs,
-      const JSONNode rhs) const {
+      const JSONNode& lhs,
+      const JSONNode& rhs) const {
     return lhs.node_id > rhs.node_id;
   }
 };
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "et_feeder/JSONStream.h"
+
+namespace {
+
+// SAX consumer that materializes one JSONNode per element of
+// "workload_graph" and hands it to the stream, never building a DOM.
+// Depth counts nested objects and arrays: the root object is 1, the
+// workload_graph array 2, a node object 3, arrays inside a node 4
+class JSONNodeSAXHandler : public nlohmann::json_sax<json> {
+	public:
+		JSONNodeSAXHandler(JSONGraphStream* stream) : stream_(stream) {}
+
+		bool null() override { return true; }
+
+		bool boolean(bool val) override {
+			if (!in_node_) return true;
+			if (array_field_ == INVOLVED_DIM) {
+				node_.involved_dim.push_back(val);
+			} else if (array_field_ == NO_ARRAY && key_ == "is_cpu_op") {
+				node_.is_cpu_op = val;
+			}
+			return true;
+		}
+
+		bool number_integer(number_integer_t val) override {
+			return handleInt(val);
+		}
+
+		bool number_unsigned(number_unsigned_t val) override {
+			return handleInt(static_cast<int64_t>(val));
+		}
+
+		bool number_float(number_float_t val, const string_t&) override {
+			return handleInt(static_cast<int64_t>(val));
+		}
+
+		bool string(string_t& val) override {
+			if (in_node_ && array_field_ == NO_ARRAY && key_ == "Name") {
+				node_.setName(val);
+			}
+			return true;
+		}
+
+		bool binary(binary_t&) override { return true; }
+
+		bool start_object(std::size_t) override {
+			++depth_;
+			if (in_graph_ && depth_ == 3) {
+				node_ = JSONNode();
+				in_node_ = true;
+			}
+			return true;
+		}
+
+		bool key(string_t& val) override {
+			key_ = val;
+			return true;
+		}
+
+		bool end_object() override {
+			--depth_;
+			if (in_node_ && depth_ == 2) {
+				in_node_ = false;
+				return stream_->emitNode(std::move(node_));
+			}
+			return true;
+		}
+
+		bool start_array(std::size_t) override {
+			++depth_;
+			if (depth_ == 2 && key_ == "workload_graph") {
+				in_graph_ = true;
+			} else if (in_node_ && depth_ == 4) {
+				if (key_ == "data_deps") {
+					array_field_ = DATA_DEPS;
+				} else if (key_ == "involved_dims") {
+					array_field_ = INVOLVED_DIM;
+				} else {
+					array_field_ = OTHER_ARRAY;
+				}
+			}
+			return true;
+		}
+
+		bool end_array() override {
+			--depth_;
+			if (in_node_ && depth_ == 3) {
+				if (array_field_ == INVOLVED_DIM && node_.involved_dim_size == 0) {
+					node_.involved_dim_size = node_.involved_dim.size();
+				}
+				array_field_ = NO_ARRAY;
+			}
+			if (depth_ == 1) {
+				in_graph_ = false;
+			}
+			return true;
+		}
+
+		bool parse_error(std::size_t pos, const std::string&,
+				const nlohmann::detail::exception& ex) override {
+			std::cerr << "JSON parse error at byte " << pos << ": "
+					<< ex.what() << std::endl;
+			return false;
+		}
+
+	private:
+		enum ArrayField { NO_ARRAY, DATA_DEPS, INVOLVED_DIM, OTHER_ARRAY };
+
+		bool handleInt(int64_t val) {
+			if (!in_node_) return true;
+			if (array_field_ == DATA_DEPS) {
+				node_.data_deps.push_back(val);
+				return true;
+			}
+			if (array_field_ == INVOLVED_DIM) {
+				node_.involved_dim.push_back(val != 0);
+				return true;
+			}
+			if (array_field_ == OTHER_ARRAY) return true;
+			if (key_ == "Id") node_.node_id = val;
+			else if (key_ == "NodeType") node_.node_type = static_cast<int>(val);
+			else if (key_ == "is_cpu_op") node_.is_cpu_op = (val != 0);
+			else if (key_ == "runtime") node_.runtime = val;
+			else if (key_ == "num_ops") node_.num_ops = val;
+			else if (key_ == "tensor_size") node_.tensor_size = val;
+			else if (key_ == "comm_type") node_.comm_type = val;
+			else if (key_ == "comm_priority") node_.comm_priority = static_cast<int32_t>(val);
+			else if (key_ == "comm_size") node_.comm_size = val;
+			else if (key_ == "comm_src") node_.comm_src = static_cast<int32_t>(val);
+			else if (key_ == "comm_dst") node_.comm_dst = static_cast<int32_t>(val);
+			else if (key_ == "comm_tag") node_.comm_tag = static_cast<int32_t>(val);
+			else if (key_ == "involved_dim_size") node_.involved_dim_size = static_cast<int32_t>(val);
+			return true;
+		}
+
+		JSONGraphStream* stream_;
+		JSONNode node_;
+		std::string key_;
+		int depth_ = 0;
+		bool in_graph_ = false;
+		bool in_node_ = false;
+		ArrayField array_field_ = NO_ARRAY;
+};
+
+} // namespace
+
+// JSONGraphStream constructor starts the parser thread
+JSONGraphStream::JSONGraphStream(const std::string& filename, size_t max_buffered)
+	: max_buffered_(max_buffered) {
+	parser_thread_ = std::thread(&JSONGraphStream::parseLoop, this, filename);
+}
+
+JSONGraphStream::~JSONGraphStream() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	fill_cv_.notify_all();
+	if (parser_thread_.joinable()) {
+		parser_thread_.join();
+	}
+}
+
+// Parser thread body
+void JSONGraphStream::parseLoop(std::string filename) {
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		std::cerr << "Error: Could not open " << filename << std::endl;
+	} else {
+		JSONNodeSAXHandler handler(this);
+		json::sax_parse(file, &handler);
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		done_ = true;
+	}
+	drain_cv_.notify_all();
+}
+
+// Hand a finished node over to the consumer
+bool JSONGraphStream::emitNode(JSONNode&& node) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	fill_cv_.wait(lock, [this] {
+		return buffer_.size() < max_buffered_ || stop_;
+	});
+	if (stop_) {
+		// Returning false aborts the SAX parse
+		return false;
+	}
+	buffer_.emplace_back(std::move(node));
+	lock.unlock();
+	drain_cv_.notify_all();
+	return true;
+}
+
+// Pull the next node in trace order
+bool JSONGraphStream::nextNode(JSONNode& node) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	drain_cv_.wait(lock, [this] { return !buffer_.empty() || done_; });
+	if (buffer_.empty()) {
+		return false;
+	}
+	node = std::move(buffer_.front());
+	buffer_.pop_front();
+	lock.unlock();
+	fill_cv_.notify_all();
+	return true;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "et_feeder/JSONNode.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// JSONGraphStream streams JSONNode objects out of a workload graph file
+// through the nlohmann SAX interface on a parser thread, so only a
+// bounded number of nodes is ever resident instead of the whole DOM
+class JSONGraphStream {
+	public:
+		JSONGraphStream(const std::string& filename, size_t max_buffered);
+		~JSONGraphStream();
+		// Blocks until a node is available
+		// Returns false once the graph is exhausted
+		bool nextNode(JSONNode& node);
+		// Called by the SAX handler; blocks while the buffer is full and
+		// returns false if the stream is being torn down
+		bool emitNode(JSONNode&& node);
+
+	private:
+		void parseLoop(std::string filename);
+
+		size_t max_buffered_;
+		std::deque<JSONNode> buffer_;
+		std::mutex mutex_;
+		std::condition_variable fill_cv_;
+		std::condition_variable drain_cv_;
+		bool done_ = false;
+		bool stop_ = false;
+		std::thread parser_thread_;
+};
@@ -1,554 +1,532 @@
+#include <chrono>
+
 #include "WrapperNode.h"
 
-// WrapperNode default constructor
-WrapperNode::WrapperNode() {}
-
-// WrapperNode copy constructor
-WrapperNode::WrapperNode(const WrapperNode& t) {
-	// Copy the attributes from the original instance to the new instance
-	format_type_ = t.format_type_;
-	et_feeder_ = t.et_feeder_;
-	node_ = t.node_;
-	json_node_ = t.json_node_;
-	data_ = t.data_;
-	node_idx_ = t.node_idx_;
-	involved_dim_size_ = t.involved_dim_size_;
-	involved_dim_ = t.involved_dim_;
-	push_back_queue_proto = t.push_back_queue_proto;
-	push_back_queue_json = t.push_back_queue_json;
-	dep_graph_json = t.dep_graph_json;
-	dep_free_node_id_set_json = t.dep_free_node_id_set_json;
-	dep_free_node_queue_json = t.dep_free_node_queue_json;
-	dep_unresolved_node_set_json = t.dep_unresolved_node_set_json;
-	window_size_json = t.window_size_json;
-}
-
-// WrapperNode create
-// format_type_ is assigned based on the extension of the file
-void WrapperNode::createWrapper(std::string filename) {
+// Microseconds elapsed since a steady_clock time point; used for the
+// JSON-path stats accounting
+static uint64_t elapsedUs(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+// Protobuf wrapper create
+// Only the ".et" extension is accepted; the format decision was
+// already made by picking this backend
+void ProtobufWrapperNode::createWrapper(std::string filename) {
 	std::string ext = filename.substr(filename.find_last_of(".") + 1);
-	if (ext == "et") {
-		std::cout << "Using Protobuf format" << std::endl;
-		format_type_ = Protobuf;
-		et_feeder_ = new Chakra::ETFeeder(filename);
-	}
-	else if (ext == "json") {
-		std::cout << "Using JSON format" << std::endl;
-		format_type_ = JSON;
-		jsonfile_.open(filename);
-		data_ = json::parse(jsonfile_); // Parse JSON file
-		window_size_json = data_["workload_graph"].size(); // Number of nodes
-		// For legacy purposes. The entire JSON file is read at once
-		readNextWindow();
-	}
-	else {
+	if (ext != "et") {
 		std::cerr << "Error: File format not supported." << std::endl;
 		exit(-1);
 	}
+	std::cout << "Using Protobuf format" << std::endl;
+	et_feeder_ = new Chakra::ETFeeder(filename);
 }
 
 // Release memory
-void WrapperNode::releaseMemory() {
-	switch(format_type_) {
-		case Protobuf:
-			delete et_feeder_;
-			break;
-		case JSON:
-			jsonfile_.close();
-			break;
-		default:
-			break;
-	}
+void ProtobufWrapperNode::releaseMemory() {
+	delete et_feeder_;
+	et_feeder_ = nullptr;
 }
 
-WrapperNode::~WrapperNode() {
-	// releaseMemory();
+// Add Protobuf node to dependency graph
+void ProtobufWrapperNode::addNode(std::shared_ptr<Chakra::ETFeederNode> node) {
+	et_feeder_->addNode(node);
 }
 
-// Find the index in JSON dictionary
-int64_t WrapperNode::findNodeIndexJSON(int64_t node_id) {
-	int64_t i;
-	for (i=0; i < window_size_json; i++) {
-		if (data_["workload_graph"][i]["Id"] == node_id) {
-			break;
-		}
+// Remove node from dependency graph
+void ProtobufWrapperNode::removeNode(int64_t node_id) {
+	et_feeder_->removeNode(node_id);
+}
+
+// Read nodes in a window
+void ProtobufWrapperNode::readNextWindow() {
+	et_feeder_->readNextWindow();
+}
+
+// Resolve dependencies
+void ProtobufWrapperNode::resolveDep() {
+	et_feeder_->resolveDep();
+}
+
+// Push dependency free nodes
+void ProtobufWrapperNode::pushBackIssuableNode(int64_t node_id) {
+	et_feeder_->pushBackIssuableNode(node_id);
+}
+
+// Free children
+void ProtobufWrapperNode::freeChildrenNodes(int64_t node_id) {
+	et_feeder_->freeChildrenNodes(node_id);
+}
+
+// Check if the node is valid
+bool ProtobufWrapperNode::isValidNode() {
+	return node_ != nullptr;
+}
+
+// Get next issuable node from dependency free queue
+void ProtobufWrapperNode::getNextIssuableNode() {
+	node_ = et_feeder_->getNextIssuableNode();
+}
+
+// Get node ID
+int64_t ProtobufWrapperNode::getNodeID() {
+	return node_->id();
+}
+
+// Get node name
+std::string ProtobufWrapperNode::getNodeName() {
+	return node_->name();
+}
+
+// Get node type
+int ProtobufWrapperNode::getNodeType() {
+	return node_->type();
+}
+
+// Check if CPU operation
+bool ProtobufWrapperNode::isCPUOp() {
+	return node_->is_cpu_op();
+}
+
+// Get runtime
+int64_t ProtobufWrapperNode::getRuntime() {
+	return node_->runtime();
+}
+
+// Get num ops
+int64_t ProtobufWrapperNode::getNumOps() {
+	return node_->num_ops();
+}
+
+// Get tensor size
+int64_t ProtobufWrapperNode::getTensorSize() {
+	return node_->tensor_size();
+}
+
+// Get comm type
+int64_t ProtobufWrapperNode::getCommType() {
+	return node_->comm_type();
+}
+
+// Get comm priority
+int32_t ProtobufWrapperNode::getCommPriority() {
+	return node_->comm_priority();
+}
+
+// Get comm size
+int64_t ProtobufWrapperNode::getCommSize() {
+	return node_->comm_size();
+}
+
+// Get comm src
+int32_t ProtobufWrapperNode::getCommSrc() {
+	return node_->comm_src();
+}
+
+// Get comm dst
+int32_t ProtobufWrapperNode::getCommDst() {
+	return node_->comm_dst();
+}
+
+// Get comm tag
+int32_t ProtobufWrapperNode::getCommTag() {
+	return node_->comm_tag();
+}
+
+// Get involved dim size
+int32_t ProtobufWrapperNode::getInvolvedDimSize() {
+	return node_->involved_dim_size();
+}
+
+// Get involved dim
+bool ProtobufWrapperNode::getInvolvedDim(int i) {
+	return node_->involved_dim(i);
+}
+
+// Check if has more nodes to issue
+bool ProtobufWrapperNode::hasNodesToIssue() {
+	return et_feeder_->hasNodesToIssue();
+}
+
+// Lookup Node
+void ProtobufWrapperNode::lookupNode(int64_t node_id) {
+	node_ = et_feeder_->lookupNode(node_id);
+}
+
+// Returns children protobuf nodes
+void ProtobufWrapperNode::getChildren(std::vector<std::shared_ptr<Chakra::ETFeederNode>>& childrenNodes) {
+	childrenNodes = node_->getChildren();
+}
+
+// Get instrumentation counters from the wrapped feeder
+Chakra::ETFeederStats ProtobufWrapperNode::getStats() {
+	return et_feeder_->getStats();
+}
+
+// JSON wrapper create
+// Only the ".json" extension is accepted; the format decision was
+// already made by picking this backend
+void JSONWrapperNode::createWrapper(std::string filename) {
+	std::string ext = filename.substr(filename.find_last_of(".") + 1);
+	if (ext != "json") {
+		std::cerr << "Error: File format not supported." << std::endl;
+		exit(-1);
 	}
-	return i;
+	std::cout << "Using JSON format" << std::endl;
+	// Nodes are streamed off a SAX parser thread window by window,
+	// so only the active window is ever resident
+	window_size_json = 4096 * 256;
+	json_stream_ = new JSONGraphStream(filename, window_size_json);
+	readNextWindow();
 }
 
-// Overloaded function - addNode
-// Add JSON node to dependency graph
-void WrapperNode::addNode(JSONNode node) {
-	dep_graph_json[node.node_id] = node;
+// Release memory
+void JSONWrapperNode::releaseMemory() {
+	delete json_stream_;
+	json_stream_ = nullptr;
 }
 
-// Add Protobuf node to dependency graph
-void WrapperNode::addNode(std::shared_ptr<Chakra::ETFeederNode> node) {
-	et_feeder_->addNode(node);
+// Resolve a node id against the loaded dependency graph
+// With the streaming parser there is no DOM to index into anymore, so
+// this returns the id itself when the node is resident and -1 otherwise
+int64_t JSONWrapperNode::findNodeIndexJSON(int64_t node_id) {
+	if (dep_graph_json.find(node_id) != dep_graph_json.end()) {
+		return node_id;
+	}
+	return -1;
+}
+
+// Add JSON node to dependency graph
+// The graph is the single owner; the argument is moved into it
+void JSONWrapperNode::addNode(JSONNode node) {
+	int64_t node_id = node.node_id;
+	dep_graph_json[node_id] = std::move(node);
 }
 
 // Remove node from dependency graph
-void WrapperNode::removeNode(int64_t node_id) {
-	switch(format_type_) {
-		case Protobuf:
-			et_feeder_->removeNode(node_id);
-			break;
-		case JSON:
-			dep_graph_json.erase(node_id);
-			break;
-		default:
-			break;
+void JSONWrapperNode::removeNode(int64_t node_id) {
+	if (dep_graph_json.erase(node_id) != 0) {
+		++json_stat_nodes_retired_;
+	}
+	// Refill the window once the dep-free queue drains, the same
+	// way ETFeeder does for protobuf traces
+	if (!json_complete_ &&
+		(dep_free_node_queue_json.size() < (size_t)window_size_json)) {
+		readNextWindow();
 	}
 }
 
-// Read nodes in graph
-// node_idx is the continuous index of the JSON nodes and is different from node_id
-JSONNode WrapperNode::readNode(int64_t node_idx) {
-	JSONNode node(data_, node_idx);
+// Link a streamed node against the nodes already in the graph
+void JSONWrapperNode::linkNode(JSONNode& node) {
 	bool dep_unresolved = false;
-	for (int i = 0; i < node.data_deps.size(); ++i) {
+	for (size_t i = 0; i < node.data_deps.size(); ++i) {
 		auto parent_node = dep_graph_json.find(node.data_deps[i]);
 		if (parent_node != dep_graph_json.end()) {
-			parent_node->second.addChild(node); // Add node as a child to the parent node
+			parent_node->second.addChild(node.node_id); // Add node as a child to the parent node
 		} else {
 			dep_unresolved = true;
 			node.addDepUnresolvedParentID(node.data_deps[i]);
+			// Register the child against the missing parent id so the
+			// parent's arrival resolves it directly, without rescanning
+			// every unresolved node
+			dep_waiters_json[node.data_deps[i]].push_back(node.node_id);
 		}
 	}
 
 	if (dep_unresolved) {
-		dep_unresolved_node_set_json.emplace(node);
+		dep_unresolved_node_id_set_json.emplace(node.node_id);
 	}
-
-	return node;
 }
 
 // Read nodes in a window
-// For JSON, the entire graph is read in a single window
-void WrapperNode::readNextWindow() {
+// Nodes come off the SAX parser thread in trace order; only the active
+// window's nodes are kept resident
+void JSONWrapperNode::readNextWindow() {
+  auto start = std::chrono::steady_clock::now();
   int32_t num_read = 0;
-  do {
-    JSONNode new_node = readNode(num_read);
-    addNode(new_node);
+  JSONNode new_node;
+  while ((num_read < window_size_json) ||
+	  (dep_unresolved_node_id_set_json.size() != 0)) {
+    if (!json_stream_->nextNode(new_node)) {
+      json_complete_ = true;
+      break;
+    }
+    linkNode(new_node);
+    int64_t new_node_id = new_node.node_id;
+    addNode(std::move(new_node));
     ++num_read;
-    resolveDep();
-  } while ((num_read < window_size_json) || (dep_unresolved_node_set_json.size() != 0));
+    resolveWaitersJSON(new_node_id);
+  }
 
-  for (auto node_id_node : dep_graph_json) {
+  for (const auto& node_id_node : dep_graph_json) {
     int64_t node_id = node_id_node.first;
-    JSONNode node(node_id_node.second);
+    const JSONNode& node = node_id_node.second;
 	// Unordered set does not allow duplicates. So, count returns 1 if key exists, 0 otherwise
     if ((dep_free_node_id_set_json.count(node_id) == 0) &&
 		(node.data_deps.size() == 0)) {
       dep_free_node_id_set_json.emplace(node_id);
-      dep_free_node_queue_json.emplace(node);
+      dep_free_node_queue_json.emplace(node_id);
     }
   }
+
+  json_stat_nodes_read_ += num_read;
+  ++json_stat_window_refills_;
+  json_stat_read_window_time_us_ += elapsedUs(start);
+  if (dep_free_node_queue_json.size() > json_stat_queue_high_watermark_) {
+    json_stat_queue_high_watermark_ = dep_free_node_queue_json.size();
+  }
 }
 
 // Resolve dependencies
-void WrapperNode::resolveDep() {
-	switch(format_type_) {
-		case Protobuf:
-			et_feeder_->resolveDep();
-			break;
-		case JSON:
-			// Loop over unresolved nodes
-			for (auto it = dep_unresolved_node_set_json.begin();
-				it != dep_unresolved_node_set_json.end();) {
-				JSONNode node = *it;
-				std::vector<int64_t> dep_unresolved_parent_ids_json =
-					node.getDepUnresolvedParentIDs();
-				// Loop over unresolved parent IDs
-				for (auto inner_it = dep_unresolved_parent_ids_json.begin();
-					inner_it != dep_unresolved_parent_ids_json.end();) {
-					auto parent_node = dep_graph_json.find(*inner_it);
-					if (parent_node != dep_graph_json.end()) {
-						// Add current node as a child to the parent
-						parent_node->second.addChild(node);
-						inner_it = dep_unresolved_parent_ids_json.erase(inner_it);
-					} else {
-						++inner_it;
-					}
-				}
-				if (dep_unresolved_parent_ids_json.size() == 0) {
-					it = dep_unresolved_node_set_json.erase(it);
-				} else {
-					node.setDepUnresolvedParentIDs(dep_unresolved_parent_ids_json);
-					++it;
-				}
+void JSONWrapperNode::resolveDep() {
+	auto start = std::chrono::steady_clock::now();
+	// Loop over unresolved nodes
+	for (auto it = dep_unresolved_node_id_set_json.begin();
+		it != dep_unresolved_node_id_set_json.end();) {
+		auto node_it = dep_graph_json.find(*it);
+		if (node_it == dep_graph_json.end()) {
+			it = dep_unresolved_node_id_set_json.erase(it);
+			continue;
+		}
+		JSONNode& node = node_it->second;
+		std::vector<int64_t> dep_unresolved_parent_ids_json =
+			node.getDepUnresolvedParentIDs();
+		// Loop over unresolved parent IDs
+		for (auto inner_it = dep_unresolved_parent_ids_json.begin();
+			inner_it != dep_unresolved_parent_ids_json.end();) {
+			auto parent_node = dep_graph_json.find(*inner_it);
+			if (parent_node != dep_graph_json.end()) {
+				// Add current node as a child to the parent
+				parent_node->second.addChild(node.node_id);
+				inner_it = dep_unresolved_parent_ids_json.erase(inner_it);
+			} else {
+				++inner_it;
 			}
+		}
+		node.setDepUnresolvedParentIDs(dep_unresolved_parent_ids_json);
+		if (dep_unresolved_parent_ids_json.size() == 0) {
+			it = dep_unresolved_node_id_set_json.erase(it);
+		} else {
+			++it;
+		}
 	}
+	json_stat_resolve_dep_time_us_ += elapsedUs(start);
 }
 
-// Push dependency free nodes
-void WrapperNode::pushBackIssuableNode(int64_t node_id) {
-	switch(format_type_) {
-		case Protobuf:
-			et_feeder_->pushBackIssuableNode(node_id);
-			break;
-		case JSON:
-			JSONNode node = dep_graph_json[node_id];
-			dep_free_node_id_set_json.emplace(node_id);
-			dep_free_node_queue_json.emplace(node);
+// Resolve the nodes registered as waiting on node_id now that it has
+// been added to the dependency graph. Each waiter is touched once, so a
+// window's linking cost stays linear in the number of edges
+void JSONWrapperNode::resolveWaitersJSON(int64_t node_id) {
+	auto waiters = dep_waiters_json.find(node_id);
+	if (waiters == dep_waiters_json.end()) {
+		return;
 	}
-}
-
-// Free children
-void WrapperNode::freeChildrenNodes(int64_t node_id) {
-	switch(format_type_) {
-		case Protobuf:
-			et_feeder_->freeChildrenNodes(node_id);
-			break;
-		case JSON:
-			JSONNode node = dep_graph_json[node_id];
-			for (auto child : node.getChildren()) {
-				for (auto it = child.data_deps.begin();
-					it != child.data_deps.end();
-					++it) {
-					if (*it == node_id) {
-						child.data_deps.erase(it);
-						break;
-					}
-				}
-				if (child.data_deps.size() == 0) {
-					dep_free_node_id_set_json.emplace(child.node_id);
-					dep_free_node_queue_json.emplace(child);
-				}
+	auto parent_node = dep_graph_json.find(node_id);
+	for (int64_t child_id : waiters->second) {
+		auto child_node = dep_graph_json.find(child_id);
+		if (child_node == dep_graph_json.end()) {
+			continue;
+		}
+		JSONNode& child = child_node->second;
+		parent_node->second.addChild(child_id);
+		std::vector<int64_t> unresolved = child.getDepUnresolvedParentIDs();
+		for (auto it = unresolved.begin(); it != unresolved.end(); ++it) {
+			if (*it == node_id) {
+				unresolved.erase(it);
+				break;
 			}
-			break;
-	}
-}
-
-// Check if the node is valid
-bool WrapperNode::isValidNode() {
-	switch (format_type_) {
-		case Protobuf:
-			if (node_ == nullptr)
-				return false;
-			else 
-				return true;
-		case JSON:
-			if (node_idx_ < 0)
-				return false;
-			else
-				return true;
-		default:
-			std::cerr << "Error in isValid()" << std::endl;
-			exit(-1);
+		}
+		child.setDepUnresolvedParentIDs(unresolved);
+		if (unresolved.size() == 0) {
+			dep_unresolved_node_id_set_json.erase(child_id);
+		}
 	}
+	dep_waiters_json.erase(waiters);
 }
 
-// Push node to queue
-void WrapperNode::push_to_queue() {
-	switch (format_type_) {
-		case Protobuf:
-			push_back_queue_proto.push(node_);
-			break;
-		case JSON:
-			// JSONNode json_node(data_, node_idx_);
-			push_back_queue_json.push(json_node_);
-			break;
-	}
+// Push dependency free nodes
+void JSONWrapperNode::pushBackIssuableNode(int64_t node_id) {
+	dep_free_node_id_set_json.emplace(node_id);
+	dep_free_node_queue_json.emplace(node_id);
 }
 
-// Check if queue is empty
-bool WrapperNode::is_queue_empty() {
-	switch (format_type_) {
-		case Protobuf:
-			return push_back_queue_proto.empty();
-			break;
-		case JSON:
-			return push_back_queue_json.empty();
-			break;
-		default:
-			std::cerr << "Error in is_queue_empty()" << std::endl;
-			exit(-1);
+// Free children
+void JSONWrapperNode::freeChildrenNodes(int64_t node_id) {
+	auto start = std::chrono::steady_clock::now();
+	auto node_it = dep_graph_json.find(node_id);
+	if (node_it == dep_graph_json.end()) {
+		json_stat_free_children_time_us_ += elapsedUs(start);
+		return;
+	}
+	// Children are resolved through the owning graph, so the
+	// dependency is erased on the stored node itself rather than
+	// on a throwaway copy
+	for (int64_t child_id : node_it->second.getChildren()) {
+		auto child_it = dep_graph_json.find(child_id);
+		if (child_it == dep_graph_json.end()) {
+			continue;
+		}
+		JSONNode& child = child_it->second;
+		for (auto it = child.data_deps.begin();
+			it != child.data_deps.end();
+			++it) {
+			if (*it == node_id) {
+				child.data_deps.erase(it);
+				break;
+			}
+		}
+		if (child.data_deps.size() == 0) {
+			if (dep_free_node_id_set_json.emplace(child_id).second) {
+				dep_free_node_queue_json.emplace(child_id);
+			}
+		}
 	}
-}
-
-// Get element in the queue front
-void WrapperNode::queue_front() {
-	switch (format_type_) {
-		case Protobuf:
-			node_ = push_back_queue_proto.front();
-		case JSON: 
-			json_node_ = push_back_queue_json.front();
-		default:
-			std::cerr << "Error in queue_front()" << std::endl;
-			exit(-1);
+	if (dep_free_node_queue_json.size() > json_stat_queue_high_watermark_) {
+		json_stat_queue_high_watermark_ = dep_free_node_queue_json.size();
 	}
+	json_stat_free_children_time_us_ += elapsedUs(start);
 }
 
-// Pop node from queue
-void WrapperNode::pop_from_queue() {
-	switch (format_type_) {
-		case Protobuf:
-			push_back_queue_proto.pop();
-		case JSON:
-			push_back_queue_json.pop();
-		default:
-			std::cerr << "Error in pop_from_queue()" << std::endl;
-			exit(-1);
-	}
+// Check if the node is valid
+bool JSONWrapperNode::isValidNode() {
+	return node_idx_ >= 0;
 }
 
 // Get next issuable node from dependency free queue
-void WrapperNode::getNextIssuableNode() {
-	switch (format_type_) {
-		case Protobuf:
-			node_ = et_feeder_->getNextIssuableNode();
-			break;
-		case JSON:
-			if (dep_free_node_queue_json.size() != 0) {
-				json_node_ = dep_free_node_queue_json.top();
-				node_idx_ = findNodeIndexJSON(json_node_.node_id);
-				dep_free_node_id_set_json.erase(json_node_.node_id);
-				dep_free_node_queue_json.pop();
-			}
-			else
-				node_idx_ = -1;
-			break;
-		default:
-			break;
+void JSONWrapperNode::getNextIssuableNode() {
+	if (dep_free_node_queue_json.size() != 0) {
+		int64_t node_id = dep_free_node_queue_json.top();
+		// Copy the issued node out of the graph so its fields
+		// stay readable after removeNode
+		json_node_ = dep_graph_json[node_id];
+		node_idx_ = findNodeIndexJSON(node_id);
+		dep_free_node_id_set_json.erase(node_id);
+		dep_free_node_queue_json.pop();
+		++json_stat_nodes_issued_;
 	}
+	else
+		node_idx_ = -1;
 }
 
 // Get node ID
-int64_t WrapperNode::getNodeID() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->id();
-		case JSON:
-			return json_node_.node_id;
-		default:
-			std::cerr << "Error in getNodeID()" << std::endl;
-			exit(-1);
-	}
+int64_t JSONWrapperNode::getNodeID() {
+	return json_node_.node_id;
 }
 
 // Get node name
-std::string WrapperNode::getNodeName() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->name();
-		case JSON:
-			return json_node_.node_name;
-		default:
-			std::cerr << "Error in getNodeName()" << std::endl;
-			exit(-1);
-	}
+std::string JSONWrapperNode::getNodeName() {
+	return json_node_.name();
 }
 
 // Get node type
-int WrapperNode::getNodeType() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->type();
-		case JSON:
-			return json_node_.node_type;
-		default:
-			std::cerr << "Error in getNodeType()" << std::endl;
-			exit(-1);
-	}
+int JSONWrapperNode::getNodeType() {
+	return json_node_.node_type;
 }
 
 // Check if CPU operation
-bool WrapperNode::isCPUOp() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->is_cpu_op();
-		case JSON:
-			return json_node_.is_cpu_op;
-		default:
-			std::cerr << "Error in isCPUOp()" << std::endl;
-			exit(-1);
-	}
+bool JSONWrapperNode::isCPUOp() {
+	return json_node_.is_cpu_op;
 }
 
 // Get runtime
-int64_t WrapperNode::getRuntime() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->runtime();
-		case JSON:
-			return json_node_.runtime;
-		default:
-			std::cerr << "Error in getRuntime()" << std::endl;
-			exit(-1);
-	}
+int64_t JSONWrapperNode::getRuntime() {
+	return json_node_.runtime;
 }
 
 // Get num ops
-int64_t WrapperNode::getNumOps() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->num_ops();
-		case JSON:
-			return json_node_.num_ops;
-		default:
-			std::cerr << "Error in getNumOps()" << std::endl;
-			exit(-1);
-	}
+int64_t JSONWrapperNode::getNumOps() {
+	return json_node_.num_ops;
 }
 
 // Get tensor size
-int64_t WrapperNode::getTensorSize() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->tensor_size();
-		case JSON:
-			return json_node_.tensor_size;
-		default:
-			std::cerr << "Error in getTensorSize()" << std::endl;
-			exit(-1);
-	}
+int64_t JSONWrapperNode::getTensorSize() {
+	return json_node_.tensor_size;
 }
 
 // Get comm type
-int64_t WrapperNode::getCommType() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->comm_type();
-		case JSON:
-			return json_node_.comm_type;
-		default:
-			std::cerr << "Error in getCommType()" << std::endl;
-			exit(-1);
-	}
+int64_t JSONWrapperNode::getCommType() {
+	return json_node_.comm_type;
 }
 
 // Get comm priority
-int32_t WrapperNode::getCommPriority() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->comm_priority();
-		case JSON:
-			return json_node_.comm_priority;
-		default:
-			std::cerr << "Error in getCommPriority()" << std::endl;
-			exit(-1);
-	}
+int32_t JSONWrapperNode::getCommPriority() {
+	return json_node_.comm_priority;
 }
 
 // Get comm size
-int64_t WrapperNode::getCommSize() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->comm_size();
-		case JSON:
-			return json_node_.comm_size;
-		default:
-			std::cerr << "Error in getCommSize()" << std::endl;
-			exit(-1);
-	}
+int64_t JSONWrapperNode::getCommSize() {
+	return json_node_.comm_size;
 }
 
 // Get comm src
-int32_t WrapperNode::getCommSrc() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->comm_src();
-		case JSON:
-			return json_node_.comm_src;
-		default:
-			std::cerr << "Error in getCommSrc()" << std::endl;
-			exit(-1);
-	}
+int32_t JSONWrapperNode::getCommSrc() {
+	return json_node_.comm_src;
 }
 
 // Get comm dst
-int32_t WrapperNode::getCommDst() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->comm_dst();
-		case JSON:
-			return json_node_.comm_dst;
-		default:
-			std::cerr << "Error in getCommDst()" << std::endl;
-			exit(-1);
-	}
+int32_t JSONWrapperNode::getCommDst() {
+	return json_node_.comm_dst;
 }
 
 // Get comm tag
-int32_t WrapperNode::getCommTag() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->comm_tag();
-		case JSON:
-			return json_node_.comm_tag;
-		default:
-			std::cerr << "Error in getCommTag()" << std::endl;
-			exit(-1);
-	}
+int32_t JSONWrapperNode::getCommTag() {
+	return json_node_.comm_tag;
 }
 
 // Get involved dim size
-int32_t WrapperNode::getInvolvedDimSize() {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->involved_dim_size();
-		case JSON:
-			return json_node_.involved_dim_size;
-		default:
-			std::cerr << "Error in getInvolvedDimSize()" << std::endl;
-			exit(-1);
-	}
+int32_t JSONWrapperNode::getInvolvedDimSize() {
+	return json_node_.involved_dim_size;
 }
 
 // Get involved dim
-bool WrapperNode::getInvolvedDim(int i) {
-	switch (format_type_) {
-		case Protobuf:
-			return node_->involved_dim(i);
-		case JSON:
-			return json_node_.involved_dim[i];
-		default:
-			std::cerr << "Error in getInvolvedDim()" << std::endl;
-			exit(-1);
-	}
+bool JSONWrapperNode::getInvolvedDim(int i) {
+	return json_node_.involved_dim[i];
 }
 
 // Check if has more nodes to issue
-bool WrapperNode::hasNodesToIssue() {
-	switch (format_type_) {
-		case Protobuf:
-			return et_feeder_->hasNodesToIssue();
-		case JSON:
-			return !(dep_graph_json.empty() && dep_free_node_queue_json.empty());
-		default:
-			std::cerr << "Error in hasNodesToIssue()" << std::endl;
-			exit(-1);
-	}
+bool JSONWrapperNode::hasNodesToIssue() {
+	return !(dep_graph_json.empty() && dep_free_node_queue_json.empty());
 }
 
 // Lookup Node
-void WrapperNode::lookupNode(int64_t node_id) {
-	switch (format_type_) {
-		case Protobuf:
-			node_ = et_feeder_->lookupNode(node_id);
-			break;
-		case JSON:
-			try {
-				json_node_ = dep_graph_json.at(node_id);
-			} catch (const std::out_of_range& e) {
-				std::cerr << "looking for node_id=" << node_id
-						<< " in dep graph, however, not loaded yet" << std::endl;
-				throw(e);
-			}
-			break;
-		default:
-			std::cerr << "Error in lookupNode()" << std::endl;
-			exit(-1);
+void JSONWrapperNode::lookupNode(int64_t node_id) {
+	try {
+		json_node_ = dep_graph_json.at(node_id);
+	} catch (const std::out_of_range& e) {
+		std::cerr << "looking for node_id=" << node_id
+				<< " in dep graph, however, not loaded yet" << std::endl;
+		throw(e);
+	}
+}
+
+// Returns children JSON nodes
+// Children ids are resolved against the owning graph; children already
+// removed from it are skipped
+void JSONWrapperNode::getChildren(std::vector<JSONNode>& childrenNodes) {
+	childrenNodes.clear();
+	for (int64_t child_id : json_node_.getChildren()) {
+		auto it = dep_graph_json.find(child_id);
+		if (it != dep_graph_json.end()) {
+			childrenNodes.emplace_back(it->second);
+		}
 	}
 }
 
-// Overloaded function returns children protobuf nodes
-void WrapperNode::getChildren(std::vector<std::shared_ptr<Chakra::ETFeederNode>>& childrenNodes) {
-	childrenNodes = node_->getChildren();
-}
-
-// Overloaded function returns children JSON nodes
-void WrapperNode::getChildren(std::vector<JSONNode>& childrenNodes) {
-	childrenNodes = json_node_.getChildren();
+// Get the wrapper's own instrumentation counters
+Chakra::ETFeederStats JSONWrapperNode::getStats() {
+	Chakra::ETFeederStats stats;
+	stats.nodes_read = json_stat_nodes_read_;
+	// The JSON path has no decode-time filter
+	stats.nodes_filtered = 0;
+	stats.nodes_issued = json_stat_nodes_issued_;
+	stats.nodes_retired = json_stat_nodes_retired_;
+	stats.window_refills = json_stat_window_refills_;
+	// JSON windows refill synchronously inside removeNode, so
+	// the consumer never observes a drained queue mid-trace
+	stats.window_refill_stalls = 0;
+	stats.dep_free_queue_high_watermark = json_stat_queue_high_watermark_;
+	stats.read_window_time_us = json_stat_read_window_time_us_;
+	stats.resolve_dep_time_us = json_stat_resolve_dep_time_us_;
+	stats.free_children_time_us = json_stat_free_children_time_us_;
+	return stats;
 }
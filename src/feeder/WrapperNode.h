@@ -3,6 +3,7 @@
 #include "et_feeder/et_feeder.h"
 #include "et_feeder/et_feeder_node.h"
 #include "et_feeder/JSONNode.h"
+#include "et_feeder/JSONStream.h"
 
 using json = nlohmann::json;
 
@@ -11,51 +12,120 @@ enum format {
 	JSON
 };
 
-// WrapperNode class wraps protobuf and JSON
-class WrapperNode {
+// Static-dispatch wrapper family. The trace format is decided once at
+// open time by instantiating the matching backend, so every hot-path
+// call is a direct member call instead of a runtime switch on
+// format_type_, and each backend only carries its own state. The CRTP
+// base holds the push-back queue, which is the only machinery the
+// formats genuinely share; Backend provides currentNode() and its
+// node reference type
+template <typename Backend, typename NodeRef>
+class WrapperNodeBase {
 	public:
-		enum format format_type_;
-		Chakra::ETFeeder* et_feeder_;
+		void push_to_queue() {
+			push_back_queue_.push(backend().currentNode());
+		}
+
+		bool is_queue_empty() {
+			return push_back_queue_.empty();
+		}
+
+		void queue_front() {
+			backend().currentNode() = push_back_queue_.front();
+		}
+
+		void pop_from_queue() {
+			push_back_queue_.pop();
+		}
+
+	protected:
+		Backend& backend() {
+			return *static_cast<Backend*>(this);
+		}
+
+		std::queue<NodeRef> push_back_queue_;
+};
+
+// Protobuf backend: a thin veneer over the wrapped ETFeeder plus the
+// currently issued node
+class ProtobufWrapperNode : public WrapperNodeBase<
+		ProtobufWrapperNode,
+		std::shared_ptr<Chakra::ETFeederNode>> {
+	public:
+		Chakra::ETFeeder* et_feeder_ = nullptr;
 		std::shared_ptr<Chakra::ETFeederNode> node_ {nullptr};
-		std::ifstream jsonfile_;
-		json data_;
+
+		std::shared_ptr<Chakra::ETFeederNode>& currentNode() {
+			return node_;
+		}
+
+		void createWrapper(std::string filename);
+		void releaseMemory();
+		void addNode(std::shared_ptr<Chakra::ETFeederNode> node);
+		void removeNode(int64_t node_id);
+		void readNextWindow();
+		void resolveDep();
+		void pushBackIssuableNode(int64_t node_id);
+		void freeChildrenNodes(int64_t node_id);
+		bool isValidNode();
+		void getNextIssuableNode();
+		int64_t getNodeID();
+		std::string getNodeName();
+		int getNodeType();
+		bool isCPUOp();
+		int64_t getRuntime();
+		int64_t getNumOps();
+		int64_t getTensorSize();
+		int64_t getCommType();
+		int32_t getCommPriority();
+		int64_t getCommSize();
+		int32_t getCommSrc();
+		int32_t getCommDst();
+		int32_t getCommTag();
+		int32_t getInvolvedDimSize();
+		bool getInvolvedDim(int i);
+		bool hasNodesToIssue();
+		void lookupNode(int64_t node_id);
+		void getChildren(std::vector<std::shared_ptr<Chakra::ETFeederNode>>& childrenNodes);
+		Chakra::ETFeederStats getStats();
+};
+
+// JSON backend: owns the streamed dependency graph and its windowing
+// state; a protobuf open never pays for any of it
+class JSONWrapperNode : public WrapperNodeBase<JSONWrapperNode, JSONNode> {
+	public:
+		JSONGraphStream* json_stream_ = nullptr;
+		bool json_complete_ = false;
 		JSONNode json_node_;
 		int64_t node_idx_ = -1;
-		int32_t involved_dim_size_ = 1;
-		std::vector<bool> involved_dim_;
-		std::queue<std::shared_ptr<Chakra::ETFeederNode>> push_back_queue_proto;
-		std::queue<JSONNode> push_back_queue_json;
+		// Single owning store for JSON nodes; every other structure
+		// refers to nodes by id
 		std::unordered_map<int64_t, JSONNode> dep_graph_json{};
-  		std::unordered_set<int64_t> dep_free_node_id_set_json{};
+		std::unordered_set<int64_t> dep_free_node_id_set_json{};
 		std::priority_queue<
-			JSONNode, //type of stored elements
-			std::vector<JSONNode>, // underlying container to store elements
-			CompareJSONNodesGT> // compare type providing a strick weak ordering
+			int64_t, //type of stored elements
+			std::vector<int64_t>, // underlying container to store elements
+			std::greater<int64_t>> // lowest node id issues first
 			dep_free_node_queue_json{};
-  		std::unordered_set<JSONNode, std::hash<JSONNode>> dep_unresolved_node_set_json{};
-		int window_size_json;
+		std::unordered_set<int64_t> dep_unresolved_node_id_set_json{};
+		std::unordered_map<int64_t, std::vector<int64_t>> dep_waiters_json{};
+		int window_size_json = 0;
+
+		JSONNode& currentNode() {
+			return json_node_;
+		}
 
-		WrapperNode();
-		WrapperNode(const WrapperNode& t);
-		~WrapperNode();
-		void releaseMemory();
 		void createWrapper(std::string filename);
+		void releaseMemory();
 		void addNode(JSONNode node);
-		void addNode(std::shared_ptr<Chakra::ETFeederNode> node);
 		void removeNode(int64_t node_id);
 		void readNextWindow();
-		JSONNode readNode(int64_t node_id);
+		void linkNode(JSONNode& node);
 		void resolveDep();
+		void resolveWaitersJSON(int64_t node_id);
 		void pushBackIssuableNode(int64_t node_id);
 		void freeChildrenNodes(int64_t node_id);
-		void addDepUnresolvedParentID(int64_t node_id);
-		std::vector<int64_t> getDepUnresolvedParentIDs();
-		void setDepUnresolvedParentIDs(std::vector<int64_t> const& dep_unresolved_parent_ids);
 		bool isValidNode();
-		void push_to_queue();
-		bool is_queue_empty();
-		void queue_front();
-		void pop_from_queue();
 		void getNextIssuableNode();
 		int64_t getNodeID();
 		std::string getNodeName();
@@ -63,9 +133,9 @@ class WrapperNode {
 		bool isCPUOp();
 		int64_t getRuntime();
 		int64_t getNumOps();
-		int64_t getTensorSize(); 
+		int64_t getTensorSize();
 		int64_t getCommType();
-		int32_t getCommPriority(); 
+		int32_t getCommPriority();
 		int64_t getCommSize();
 		int32_t getCommSrc();
 		int32_t getCommDst();
@@ -74,7 +144,18 @@ class WrapperNode {
 		bool getInvolvedDim(int i);
 		bool hasNodesToIssue();
 		void lookupNode(int64_t node_id);
-		void getChildren(std::vector<std::shared_ptr<Chakra::ETFeederNode>>& childrenNodes);
 		void getChildren(std::vector<JSONNode>& childrenNodes);
 		int64_t findNodeIndexJSON(int64_t node_id);
+		Chakra::ETFeederStats getStats();
+
+	private:
+		// The JSON path is single threaded so plain counters are enough
+		uint64_t json_stat_nodes_read_ = 0;
+		uint64_t json_stat_nodes_issued_ = 0;
+		uint64_t json_stat_nodes_retired_ = 0;
+		uint64_t json_stat_window_refills_ = 0;
+		uint64_t json_stat_queue_high_watermark_ = 0;
+		uint64_t json_stat_read_window_time_us_ = 0;
+		uint64_t json_stat_resolve_dep_time_us_ = 0;
+		uint64_t json_stat_free_children_time_us_ = 0;
 };
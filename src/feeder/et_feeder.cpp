@@ -1,16 +1,88 @@
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
 #include "et_feeder/et_feeder.h"
 
 using namespace std;
 using namespace Chakra;
 
-ETFeeder::ETFeeder(string filename)
-    : trace_(filename), window_size_(4096 * 256), et_complete_(false) {
+// Microseconds elapsed since a steady_clock time point; used for the
+// per-phase stats accounting
+static uint64_t elapsedUs(chrono::steady_clock::time_point start) {
+  return chrono::duration_cast<chrono::microseconds>(
+             chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Sidecar index file layout: magic, version, trace file size, followed
+// by (node_id, byte offset) pairs for every node in the trace
+static const uint32_t index_magic = 0x58444945; // "EIDX"
+static const uint32_t index_version = 1;
+
+// Sidecar preprocessed-graph cache layout: magic, version, trace file
+// size and mtime, node count, then one record per node in trace order
+// (see ETFeederNode::writeCacheRecord). The version must be bumped
+// whenever the record layout or the extracted field set changes
+static const uint32_t cache_magic = 0x48434745; // "EGCH"
+static const uint32_t cache_version = 1;
+
+// Checkpoint layout: magic, version, trace file size and mtime, the
+// consumed node count and stream offset, then the live window (node
+// records with their current dependency state). Version 2 adds the
+// filtered-node count and the dependency remap table
+static const uint32_t snapshot_magic = 0x4e534745; // "EGSN"
+static const uint32_t snapshot_version = 2;
+
+// Size and mtime of the trace file, used to invalidate the cache when
+// the trace is rewritten
+static bool traceStat(const string& filename, uint64_t& size, uint64_t& mtime) {
+  struct stat file_stat;
+  if (stat(filename.c_str(), &file_stat) != 0) {
+    return false;
+  }
+  size = static_cast<uint64_t>(file_stat.st_size);
+  mtime = static_cast<uint64_t>(file_stat.st_mtime);
+  return true;
+}
+
+ETFeeder::ETFeeder(string filename, bool enable_prefetch, NodeFilter keep_node)
+    : filename_(filename),
+      trace_(filename),
+      filter_(std::move(keep_node)),
+      window_size_(4096 * 256),
+      et_complete_(false),
+      index_loaded_(false),
+      prefetch_enabled_(enable_prefetch),
+      prefetch_stop_(false),
+      trace_eof_(false) {
   if (!trace_.is_open()) { // Assuming a method to check if file is open
     throw std::runtime_error("Failed to open trace file: " + filename);
   }
 
   try {
     readGlobalMetadata();
+    consumed_offset_ = trace_.tell();
+    if (loadCacheHeader()) {
+      // A valid cache replaces the decode path entirely, so the
+      // prefetch thread has nothing to do
+      cache_mode_ = true;
+      prefetch_enabled_ = false;
+    } else {
+      // The graph cache describes the unfiltered trace, so a filtered
+      // load never builds one
+      if (!filter_) {
+        startCacheWrite();
+      }
+      if (prefetch_enabled_) {
+        // The pipeline threads are the only readers of the trace from
+        // here on; they decode ahead while the simulator consumes the
+        // current window
+        startPipeline();
+      }
+    }
     readNextWindow();
   } catch (const std::exception& e) {
     cerr << "Error in constructor: " << e.what() << endl;
@@ -18,43 +90,495 @@ ETFeeder::ETFeeder(string filename)
   }
 }
 
-ETFeeder::~ETFeeder() {}
+ETFeeder::~ETFeeder() {
+  stopPipeline();
+  if (cache_write_active_) {
+    // The trace was not read to completion, so the partial cache is
+    // useless; the next open will parse and try again
+    cache_out_.close();
+    remove((filename_ + ".gcache.tmp").c_str());
+  }
+}
+
+void ETFeeder::startPipeline() {
+  prefetch_stop_ = false;
+  splitter_thread_ = thread(&ETFeeder::splitterLoop, this);
+  parser_threads_.reserve(num_parser_threads_);
+  for (uint32_t i = 0; i < num_parser_threads_; ++i) {
+    parser_threads_.emplace_back(&ETFeeder::parserLoop, this);
+  }
+}
+
+void ETFeeder::stopPipeline() {
+  {
+    lock_guard<mutex> lock(prefetch_mutex_);
+    prefetch_stop_ = true;
+  }
+  prefetch_fill_cv_.notify_all();
+  parse_cv_.notify_all();
+  if (splitter_thread_.joinable()) {
+    splitter_thread_.join();
+  }
+  for (auto& parser_thread : parser_threads_) {
+    if (parser_thread.joinable()) {
+      parser_thread.join();
+    }
+  }
+  parser_threads_.clear();
+}
+
+void ETFeeder::splitterLoop() {
+  // I/O stage: slice raw length-prefixed records off the trace and
+  // tag them with a sequence number for in-order delivery
+  while (true) {
+    {
+      unique_lock<mutex> lock(prefetch_mutex_);
+      prefetch_fill_cv_.wait(lock, [this] {
+        return ((next_split_seq_ - next_consume_seq_) < window_size_) ||
+            prefetch_stop_;
+      });
+      if (prefetch_stop_) {
+        return;
+      }
+    }
+
+    RawRecord record;
+    bool read_ok;
+    {
+      lock_guard<mutex> lock(trace_mutex_);
+      read_ok = trace_.readRecord(record.bytes);
+      record.end_offset = trace_.tell();
+    }
+
+    {
+      lock_guard<mutex> lock(prefetch_mutex_);
+      if (!read_ok) {
+        trace_eof_ = true;
+      } else {
+        record.seq = next_split_seq_++;
+        raw_records_.emplace_back(move(record));
+      }
+    }
+    if (!read_ok) {
+      // Wake everything: parsers drain what is queued and exit, and
+      // the consumer can observe the end of the trace
+      parse_cv_.notify_all();
+      prefetch_drain_cv_.notify_all();
+      return;
+    }
+    parse_cv_.notify_one();
+  }
+}
+
+void ETFeeder::parserLoop() {
+  // Parse stage: decode raw records into arena messages in parallel;
+  // completion order does not matter thanks to the reorder buffer
+  while (true) {
+    RawRecord record;
+    {
+      unique_lock<mutex> lock(prefetch_mutex_);
+      parse_cv_.wait(lock, [this] {
+        return !raw_records_.empty() || prefetch_stop_ || trace_eof_;
+      });
+      if (prefetch_stop_) {
+        return;
+      }
+      if (raw_records_.empty()) {
+        return; // trace exhausted and nothing left to parse
+      }
+      record = move(raw_records_.front());
+      raw_records_.pop_front();
+    }
+
+    shared_ptr<ChakraProtoMsg::Node> pkt_msg = allocateNodeMsg();
+    bool parse_ok = pkt_msg->ParseFromArray(
+        record.bytes.data(), static_cast<int>(record.bytes.size()));
+
+    {
+      lock_guard<mutex> lock(prefetch_mutex_);
+      parsed_msgs_[record.seq] =
+          make_pair(parse_ok ? move(pkt_msg) : nullptr, record.end_offset);
+    }
+    prefetch_drain_cv_.notify_all();
+  }
+}
+
+shared_ptr<ChakraProtoMsg::Node> ETFeeder::allocateNodeMsg() {
+  // The parser pool allocates concurrently from the shared arena
+  lock_guard<mutex> arena_lock(arena_mutex_);
+  // Rotate to a fresh arena at window granularity so a window's nodes
+  // are laid out contiguously and retired together
+  if ((arena_ == nullptr) || (arena_alloc_count_ >= window_size_)) {
+    arena_ = make_shared<google::protobuf::Arena>();
+    arena_alloc_count_ = 0;
+  }
+  ChakraProtoMsg::Node* pkt_msg =
+      google::protobuf::Arena::CreateMessage<ChakraProtoMsg::Node>(
+          arena_.get());
+  ++arena_alloc_count_;
+  // Alias the arena's control block: the arena (and every message in
+  // it) is released in one shot when the last aliased node drops
+  return shared_ptr<ChakraProtoMsg::Node>(arena_, pkt_msg);
+}
+
+shared_ptr<ChakraProtoMsg::Node> ETFeeder::nextNodeMsg() {
+  if (!prefetch_enabled_) {
+    shared_ptr<ChakraProtoMsg::Node> pkt_msg = allocateNodeMsg();
+    lock_guard<mutex> lock(trace_mutex_);
+    if (!trace_.read(*pkt_msg)) {
+      return nullptr;
+    }
+    consumed_offset_ = trace_.tell();
+    return pkt_msg;
+  }
+
+  unique_lock<mutex> lock(prefetch_mutex_);
+  // Linker stage: deliver parsed messages strictly in sequence order
+  prefetch_drain_cv_.wait(lock, [this] {
+    return (parsed_msgs_.count(next_consume_seq_) != 0) ||
+        (trace_eof_ && (next_consume_seq_ == next_split_seq_));
+  });
+  auto it = parsed_msgs_.find(next_consume_seq_);
+  if (it == parsed_msgs_.end()) {
+    return nullptr;
+  }
+  shared_ptr<ChakraProtoMsg::Node> pkt_msg = move(it->second.first);
+  consumed_offset_ = it->second.second;
+  parsed_msgs_.erase(it);
+  ++next_consume_seq_;
+  lock.unlock();
+  prefetch_fill_cv_.notify_all();
+  // A null message marks a record that failed to decode; treat it as
+  // a truncated trace
+  return pkt_msg;
+}
+
+shared_ptr<ETFeederNode> ETFeeder::allocateNode(
+    shared_ptr<ChakraProtoMsg::Node> pkt_msg) {
+  ETFeederNode* raw = nullptr;
+  {
+    lock_guard<mutex> lock(node_pool_->mutex);
+    if (!node_pool_->free_list.empty()) {
+      raw = node_pool_->free_list.back();
+      node_pool_->free_list.pop_back();
+    }
+  }
+  if (raw != nullptr) {
+    raw->reinit(move(pkt_msg));
+  } else {
+    raw = new ETFeederNode(move(pkt_msg));
+  }
+
+  // The deleter returns the object to the pool instead of freeing it;
+  // capturing the pool by shared_ptr keeps it alive for nodes that
+  // outlive the feeder
+  shared_ptr<NodePool> pool = node_pool_;
+  return shared_ptr<ETFeederNode>(raw, [pool](ETFeederNode* node) {
+    // Drop the node's shared references first so cascaded releases of
+    // children do not run under the pool lock
+    node->recycle();
+    lock_guard<mutex> lock(pool->mutex);
+    pool->free_list.push_back(node);
+  });
+}
+
+const DepFreeBucket* DepFreeBucketQueue::findBucket(
+    uint64_t key) const {
+  uint64_t base = key & ~(DepFreeBucket::span_ - 1);
+  auto it = lower_bound(
+      buckets_.begin(),
+      buckets_.end(),
+      base,
+      [](const unique_ptr<DepFreeBucket>& bucket, uint64_t base_key) {
+        return bucket->base < base_key;
+      });
+  if ((it == buckets_.end()) || ((*it)->base != base)) {
+    return nullptr;
+  }
+  return it->get();
+}
+
+DepFreeBucket& DepFreeBucketQueue::bucketFor(
+    uint64_t key) {
+  uint64_t base = key & ~(DepFreeBucket::span_ - 1);
+  auto it = lower_bound(
+      buckets_.begin(),
+      buckets_.end(),
+      base,
+      [](const unique_ptr<DepFreeBucket>& bucket, uint64_t base_key) {
+        return bucket->base < base_key;
+      });
+  if ((it != buckets_.end()) && ((*it)->base == base)) {
+    return **it;
+  }
+  it = buckets_.insert(it, make_unique<DepFreeBucket>(base));
+  return **it;
+}
+
+bool DepFreeBucketQueue::insert(
+    uint64_t key,
+    shared_ptr<ETFeederNode> node) {
+  DepFreeBucket& bucket = bucketFor(key);
+  uint64_t slot = key - bucket.base;
+  uint64_t& word = bucket.occupied[slot >> 6];
+  uint64_t bit = uint64_t(1) << (slot & 63);
+  // The bitmap doubles as the membership set; a duplicate push is a
+  // single bit test away
+  if ((word & bit) != 0) {
+    return false;
+  }
+  word |= bit;
+  bucket.slots[slot] = move(node);
+  ++bucket.count;
+  ++count_;
+  return true;
+}
+
+bool DepFreeBucketQueue::contains(uint64_t key) const {
+  const DepFreeBucket* bucket = findBucket(key);
+  if (bucket == nullptr) {
+    return false;
+  }
+  uint64_t slot = key - bucket->base;
+  return ((bucket->occupied[slot >> 6] >> (slot & 63)) & 1) != 0;
+}
+
+shared_ptr<ETFeederNode> DepFreeBucketQueue::top() const {
+  for (const auto& bucket : buckets_) {
+    if (bucket->count == 0) {
+      continue;
+    }
+    for (size_t word = 0; word < bucket->occupied.size(); ++word) {
+      if (bucket->occupied[word] != 0) {
+        uint64_t slot = (word << 6) + __builtin_ctzll(bucket->occupied[word]);
+        return bucket->slots[slot];
+      }
+    }
+  }
+  return nullptr;
+}
+
+shared_ptr<ETFeederNode> DepFreeBucketQueue::popMin() {
+  // Fully drained leading spans are released here; emptied middle
+  // buckets are kept until they reach the front
+  while (!buckets_.empty() && (buckets_.front()->count == 0)) {
+    buckets_.pop_front();
+  }
+  for (auto& bucket_ptr : buckets_) {
+    DepFreeBucket& bucket = *bucket_ptr;
+    if (bucket.count == 0) {
+      continue;
+    }
+    for (size_t word = 0; word < bucket.occupied.size(); ++word) {
+      if (bucket.occupied[word] != 0) {
+        uint64_t slot = (word << 6) + __builtin_ctzll(bucket.occupied[word]);
+        bucket.occupied[word] &= bucket.occupied[word] - 1;
+        --bucket.count;
+        --count_;
+        return move(bucket.slots[slot]);
+      }
+    }
+  }
+  return nullptr;
+}
+
+DepFreeShard& ETFeeder::shardFor(uint64_t node_id) {
+  return dep_free_shards_[node_id % num_shards_];
+}
+
+void ETFeeder::pushDepFree(shared_ptr<ETFeederNode> node) {
+  uint64_t node_id = node->id();
+  DepFreeShard& shard = shardFor(node_id);
+  lock_guard<mutex> lock(shard.mutex);
+  // The occupancy bitmap rejects duplicates, so racing pushers cannot
+  // enqueue the same node twice
+  if (shard.queue.insert(node_id / num_shards_, move(node))) {
+    uint64_t depth = ++stat_queue_depth_;
+    uint64_t watermark = stat_queue_high_watermark_.load();
+    while ((depth > watermark) &&
+           !stat_queue_high_watermark_.compare_exchange_weak(
+               watermark, depth)) {
+    }
+  }
+}
+
+bool ETFeeder::depFreeContains(uint64_t node_id) {
+  DepFreeShard& shard = shardFor(node_id);
+  lock_guard<mutex> lock(shard.mutex);
+  return shard.queue.contains(node_id / num_shards_);
+}
+
+uint64_t ETFeeder::depFreeSize() {
+  uint64_t total = 0;
+  for (auto& shard : dep_free_shards_) {
+    lock_guard<mutex> lock(shard.mutex);
+    total += shard.queue.size();
+  }
+  return total;
+}
 
 void ETFeeder::addNode(shared_ptr<ETFeederNode> node) {
-  dep_graph_[node->getChakraNode()->id()] = node;
+  unique_lock<shared_mutex> lock(dep_graph_mutex_);
+  dep_graph_[node->id()] = node;
 }
 
 void ETFeeder::removeNode(uint64_t node_id) {
-  dep_graph_.erase(node_id);
+  {
+    unique_lock<shared_mutex> lock(dep_graph_mutex_);
+    if (dep_graph_.erase(node_id) != 0) {
+      ++stat_nodes_retired_;
+    }
+  }
 
-  if (!et_complete_ && (dep_free_node_queue_.size() < window_size_)) {
-    readNextWindow();
+  if (!et_complete_ && (depFreeSize() < window_size_)) {
+    // If another worker is already refilling there is nothing to gain
+    // from queueing up behind it
+    unique_lock<mutex> refill_lock(window_refill_mutex_, try_to_lock);
+    if (refill_lock.owns_lock()) {
+      readNextWindow();
+    }
   }
 }
 
 bool ETFeeder::hasNodesToIssue() {
-  return !(dep_graph_.empty() && dep_free_node_queue_.empty());
+  {
+    shared_lock<shared_mutex> lock(dep_graph_mutex_);
+    if (!dep_graph_.empty()) {
+      return true;
+    }
+  }
+  for (auto& shard : dep_free_shards_) {
+    lock_guard<mutex> lock(shard.mutex);
+    if (!shard.queue.empty()) {
+      return true;
+    }
+  }
+  return false;
 }
 
 shared_ptr<ETFeederNode> ETFeeder::getNextIssuableNode() {
-  if (dep_free_node_queue_.size() != 0) {
-    shared_ptr<ETFeederNode> node = dep_free_node_queue_.top();
-    dep_free_node_id_set_.erase(node->getChakraNode()->id());
-    dep_free_node_queue_.pop();
-    return node;
-  } else {
-    return nullptr;
+  // Find the lowest-id dep-free node across the shards, then pop it
+  // from its shard; retry if a concurrent pop won the race
+  while (true) {
+    bool found = false;
+    uint64_t best_id = 0;
+    uint32_t best_shard = 0;
+    for (uint32_t i = 0; i < num_shards_; ++i) {
+      lock_guard<mutex> lock(dep_free_shards_[i].mutex);
+      if (!dep_free_shards_[i].queue.empty()) {
+        uint64_t top_id = dep_free_shards_[i].queue.top()->id();
+        if (!found || (top_id < best_id)) {
+          found = true;
+          best_id = top_id;
+          best_shard = i;
+        }
+      }
+    }
+    if (!found) {
+      // Running dry while the trace still has nodes means the consumer
+      // outpaced the window refill
+      if (!et_complete_) {
+        ++stat_refill_stalls_;
+      }
+      return nullptr;
+    }
+
+    DepFreeShard& shard = dep_free_shards_[best_shard];
+    lock_guard<mutex> lock(shard.mutex);
+    if (!shard.queue.empty() && (shard.queue.top()->id() == best_id)) {
+      shared_ptr<ETFeederNode> node = shard.queue.popMin();
+      --stat_queue_depth_;
+      ++stat_nodes_issued_;
+      return node;
+    }
+  }
+}
+
+uint64_t ETFeeder::getNextIssuableNodes(
+    uint64_t max_nodes,
+    vector<shared_ptr<ETFeederNode>>& nodes) {
+  nodes.clear();
+
+  // Hold every shard for the duration of the batch and merge-pop the
+  // lowest ids. Shards are always acquired in index order here and one
+  // at a time everywhere else, so the ordering cannot deadlock
+  array<unique_lock<mutex>, num_shards_> locks;
+  for (uint32_t i = 0; i < num_shards_; ++i) {
+    locks[i] = unique_lock<mutex>(dep_free_shards_[i].mutex);
+  }
+
+  while (nodes.size() < max_nodes) {
+    bool found = false;
+    uint64_t best_id = 0;
+    uint32_t best_shard = 0;
+    for (uint32_t i = 0; i < num_shards_; ++i) {
+      if (!dep_free_shards_[i].queue.empty()) {
+        uint64_t top_id = dep_free_shards_[i].queue.top()->id();
+        if (!found || (top_id < best_id)) {
+          found = true;
+          best_id = top_id;
+          best_shard = i;
+        }
+      }
+    }
+    if (!found) {
+      break;
+    }
+    DepFreeShard& shard = dep_free_shards_[best_shard];
+    nodes.emplace_back(shard.queue.popMin());
+  }
+
+  if (nodes.empty()) {
+    if (!et_complete_) {
+      ++stat_refill_stalls_;
+    }
+    return 0;
+  }
+  stat_queue_depth_ -= nodes.size();
+  stat_nodes_issued_ += nodes.size();
+  return nodes.size();
+}
+
+void ETFeeder::retireNodes(const vector<uint64_t>& node_ids) {
+  for (uint64_t node_id : node_ids) {
+    freeChildrenNodes(node_id);
+  }
+
+  {
+    unique_lock<shared_mutex> lock(dep_graph_mutex_);
+    for (uint64_t node_id : node_ids) {
+      if (dep_graph_.erase(node_id) != 0) {
+        ++stat_nodes_retired_;
+      }
+    }
+  }
+
+  // One refill check covers the whole batch
+  if (!et_complete_ && (depFreeSize() < window_size_)) {
+    unique_lock<mutex> refill_lock(window_refill_mutex_, try_to_lock);
+    if (refill_lock.owns_lock()) {
+      readNextWindow();
+    }
   }
 }
 
 void ETFeeder::pushBackIssuableNode(uint64_t node_id) {
-  shared_ptr<ETFeederNode> node = dep_graph_[node_id];
-  dep_free_node_id_set_.emplace(node_id);
-  dep_free_node_queue_.emplace(node);
+  shared_ptr<ETFeederNode> node;
+  {
+    shared_lock<shared_mutex> lock(dep_graph_mutex_);
+    auto it = dep_graph_.find(node_id);
+    if (it == dep_graph_.end()) {
+      throw runtime_error(
+          "node_id=" + to_string(node_id) + " not in dependency graph");
+    }
+    node = it->second;
+  }
+  pushDepFree(move(node));
 }
 
 shared_ptr<ETFeederNode> ETFeeder::lookupNode(uint64_t node_id) {
   try {
+    shared_lock<shared_mutex> lock(dep_graph_mutex_);
     return dep_graph_.at(node_id);
   } catch (const std::out_of_range& e) {
     std::cerr << "looking for node_id=" << node_id
@@ -63,23 +587,171 @@ shared_ptr<ETFeederNode> ETFeeder::lookupNode(uint64_t node_id) {
   }
 }
 
+shared_ptr<ETFeederNode> ETFeeder::lookupNodeFromTrace(uint64_t node_id) {
+  {
+    shared_lock<shared_mutex> lock(dep_graph_mutex_);
+    auto it = dep_graph_.find(node_id);
+    if (it != dep_graph_.end()) {
+      return it->second;
+    }
+  }
+
+  loadOrBuildIndex();
+  auto offset_it = node_offset_index_.find(node_id);
+  if (offset_it == node_offset_index_.end()) {
+    throw runtime_error(
+        "node_id=" + to_string(node_id) + " not present in trace index");
+  }
+
+  // Fault the node in through the index, restoring the stream position
+  // so the streaming window read path is unaffected
+  shared_ptr<ChakraProtoMsg::Node> pkt_msg =
+      make_shared<ChakraProtoMsg::Node>();
+  bool read_ok;
+  {
+    lock_guard<mutex> lock(trace_mutex_);
+    uint64_t saved_offset = trace_.tell();
+    trace_.seek(offset_it->second);
+    read_ok = trace_.read(*pkt_msg);
+    trace_.seek(saved_offset);
+  }
+  if (!read_ok) {
+    throw runtime_error(
+        "Failed to read node_id=" + to_string(node_id) + " from trace");
+  }
+  return make_shared<ETFeederNode>(pkt_msg);
+}
+
+void ETFeeder::loadOrBuildIndex() {
+  // Concurrent workers can race the first fault-in; serialize the
+  // build so the index is populated exactly once and readers only see
+  // it through this barrier once it is complete
+  lock_guard<mutex> lock(index_mutex_);
+  if (index_loaded_) {
+    return;
+  }
+  const string index_filename = filename_ + ".idx";
+  if (!loadIndex(index_filename)) {
+    buildIndex(index_filename);
+  }
+  index_loaded_ = true;
+}
+
+bool ETFeeder::loadIndex(const string& index_filename) {
+  ifstream index_file(index_filename.c_str(), ios::in | ios::binary);
+  if (!index_file.good()) {
+    return false;
+  }
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t trace_size = 0;
+  uint64_t num_entries = 0;
+  index_file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  index_file.read(reinterpret_cast<char*>(&version), sizeof(version));
+  index_file.read(reinterpret_cast<char*>(&trace_size), sizeof(trace_size));
+  index_file.read(reinterpret_cast<char*>(&num_entries), sizeof(num_entries));
+  if (!index_file.good() || (magic != index_magic) ||
+      (version != index_version)) {
+    return false;
+  }
+
+  // A size mismatch means the trace was rewritten since the index was
+  // built, so the recorded offsets cannot be trusted
+  ifstream trace_file(filename_.c_str(), ios::in | ios::binary | ios::ate);
+  if (!trace_file.good() ||
+      (static_cast<uint64_t>(trace_file.tellg()) != trace_size)) {
+    return false;
+  }
+
+  node_offset_index_.reserve(num_entries);
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    uint64_t node_id = 0;
+    uint64_t offset = 0;
+    index_file.read(reinterpret_cast<char*>(&node_id), sizeof(node_id));
+    index_file.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+    if (!index_file.good()) {
+      node_offset_index_.clear();
+      return false;
+    }
+    node_offset_index_[node_id] = offset;
+  }
+  return true;
+}
+
+void ETFeeder::buildIndex(const string& index_filename) {
+  // Scan the trace once with a private stream so the main read cursor
+  // is left untouched
+  ProtoInputStream scan_trace(filename_);
+  if (!scan_trace.is_open()) {
+    throw runtime_error("Failed to open trace file for indexing: " + filename_);
+  }
+
+  ChakraProtoMsg::GlobalMetadata metadata_msg;
+  scan_trace.read(metadata_msg);
+
+  ChakraProtoMsg::Node node_msg;
+  uint64_t offset = scan_trace.tell();
+  while (scan_trace.read(node_msg)) {
+    node_offset_index_[node_msg.id()] = offset;
+    offset = scan_trace.tell();
+  }
+
+  ofstream index_file(
+      index_filename.c_str(), ios::out | ios::binary | ios::trunc);
+  if (!index_file.good()) {
+    // The index is still usable in memory even if the sidecar cannot
+    // be persisted (e.g., read-only trace directory)
+    return;
+  }
+
+  ifstream trace_file(filename_.c_str(), ios::in | ios::binary | ios::ate);
+  uint64_t trace_size = static_cast<uint64_t>(trace_file.tellg());
+  uint64_t num_entries = node_offset_index_.size();
+  index_file.write(
+      reinterpret_cast<const char*>(&index_magic), sizeof(index_magic));
+  index_file.write(
+      reinterpret_cast<const char*>(&index_version), sizeof(index_version));
+  index_file.write(
+      reinterpret_cast<const char*>(&trace_size), sizeof(trace_size));
+  index_file.write(
+      reinterpret_cast<const char*>(&num_entries), sizeof(num_entries));
+  for (const auto& entry : node_offset_index_) {
+    index_file.write(
+        reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
+    index_file.write(
+        reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
+  }
+}
+
 void ETFeeder::freeChildrenNodes(uint64_t node_id) {
-  shared_ptr<ETFeederNode> node = dep_graph_[node_id];
-  for (auto child : node->getChildren()) {
-    auto child_chakra = child->getChakraNode();
-    for (auto it = child_chakra->mutable_data_deps()->begin();
-         it != child_chakra->mutable_data_deps()->end();
-         ++it) {
-      if (*it == node_id) {
-        child_chakra->mutable_data_deps()->erase(it);
-        break;
-      }
+  auto start = chrono::steady_clock::now();
+  shared_ptr<ETFeederNode> node;
+  {
+    shared_lock<shared_mutex> lock(dep_graph_mutex_);
+    auto it = dep_graph_.find(node_id);
+    if (it == dep_graph_.end()) {
+      stat_free_children_time_us_ += elapsedUs(start);
+      return;
     }
-    if (child_chakra->data_deps().size() == 0) {
-      dep_free_node_id_set_.emplace(child_chakra->id());
-      dep_free_node_queue_.emplace(child);
+    node = it->second;
+  }
+
+  vector<shared_ptr<ETFeederNode>> children;
+  {
+    // The window loader links new children under the same shard mutex
+    lock_guard<mutex> lock(dep_mutexes_[node_id % num_shards_]);
+    children = node->getChildren();
+  }
+
+  for (auto child : children) {
+    // The atomic release keeps data_deps untouched; exactly one
+    // retiring parent observes the count hitting zero
+    if (child->releaseDependency()) {
+      pushDepFree(child);
     }
   }
+  stat_free_children_time_us_ += elapsedUs(start);
 }
 
 void ETFeeder::readGlobalMetadata() {
@@ -93,32 +765,310 @@ void ETFeeder::readGlobalMetadata() {
 }
 
 shared_ptr<ETFeederNode> ETFeeder::readNode() {
-  shared_ptr<ChakraProtoMsg::Node> pkt_msg =
-      make_shared<ChakraProtoMsg::Node>();
-  if (!trace_.read(*pkt_msg)) {
-    return nullptr;
+  for (;;) {
+    shared_ptr<ETFeederNode> node;
+    if (cache_mode_) {
+      node = readCachedNode();
+    } else {
+      shared_ptr<ChakraProtoMsg::Node> pkt_msg = nextNodeMsg();
+      if (pkt_msg == nullptr) {
+        return nullptr;
+      }
+      node = allocateNode(pkt_msg);
+
+      if (cache_write_active_) {
+        // All window refills are serialized by window_refill_mutex_, so
+        // records are appended by one thread at a time and in trace order
+        node->writeCacheRecord(cache_out_);
+        ++cache_nodes_written_;
+      }
+    }
+    if (node == nullptr) {
+      return nullptr;
+    }
+
+    if (filter_ && !filter_(*node)) {
+      // The node never reaches the dependency graph; only its retained
+      // ancestry survives, in the remap table
+      dropFilteredNode(node);
+      continue;
+    }
+
+    linkNode(node);
+    return node;
+  }
+}
+
+// Map a dependency list through the filtered-node remap table,
+// deduplicated, following chains of dropped nodes until every entry
+// names a retained node. With no filter this is a plain copy
+void ETFeeder::remapDeps(const vector<uint64_t>& deps, vector<uint64_t>& out) {
+  vector<uint64_t> work(deps.begin(), deps.end());
+  while (!work.empty()) {
+    uint64_t dep_id = work.back();
+    work.pop_back();
+    auto remap = filtered_dep_remap_.find(dep_id);
+    if (remap != filtered_dep_remap_.end()) {
+      work.insert(work.end(), remap->second.begin(), remap->second.end());
+    } else if (find(out.begin(), out.end(), dep_id) == out.end()) {
+      out.push_back(dep_id);
+    }
+  }
+}
+
+// Link a freshly read node against the dependency graph, registering
+// it as a waiter on any parent that has not been read yet
+void ETFeeder::linkNode(shared_ptr<ETFeederNode> node) {
+  const vector<uint64_t>* deps = &node->data_deps();
+  vector<uint64_t> remapped;
+  if (filter_) {
+    // Dependencies on dropped nodes collapse onto their retained
+    // ancestors; the remaining count must match the rewired edges
+    remapDeps(node->data_deps(), remapped);
+    node->setRemainingDeps(remapped.size());
+    deps = &remapped;
   }
-  shared_ptr<ETFeederNode> node = make_shared<ETFeederNode>(pkt_msg);
 
   bool dep_unresolved = false;
-  for (int i = 0; i < pkt_msg->data_deps_size(); ++i) {
-    auto parent_node = dep_graph_.find(pkt_msg->data_deps(i));
-    if (parent_node != dep_graph_.end()) {
-      parent_node->second->addChild(node);
+  for (uint64_t dep_id : *deps) {
+    shared_ptr<ETFeederNode> parent = nullptr;
+    {
+      shared_lock<shared_mutex> lock(dep_graph_mutex_);
+      auto parent_node = dep_graph_.find(dep_id);
+      if (parent_node != dep_graph_.end()) {
+        parent = parent_node->second;
+      }
+    }
+    if (parent != nullptr) {
+      lock_guard<mutex> lock(dep_mutexes_[parent->id() % num_shards_]);
+      parent->addChild(node);
     } else {
       dep_unresolved = true;
-      node->addDepUnresolvedParentID(pkt_msg->data_deps(i));
+      node->addDepUnresolvedParentID(dep_id);
+      dep_waiters_[dep_id].emplace_back(node);
     }
   }
 
   if (dep_unresolved) {
     dep_unresolved_node_set_.emplace(node);
   }
+}
+
+// Collapse a node rejected by the filter out of the graph: record its
+// retained ancestors for later readers of its id, and rewire children
+// already waiting on it so the retained subgraph keeps the original
+// ordering
+void ETFeeder::dropFilteredNode(shared_ptr<ETFeederNode> node) {
+  vector<uint64_t> ancestors;
+  remapDeps(node->data_deps(), ancestors);
+
+  auto waiters = dep_waiters_.find(node->id());
+  if (waiters != dep_waiters_.end()) {
+    for (auto& child : waiters->second) {
+      vector<uint64_t> unresolved = child->getDepUnresolvedParentIDs();
+      for (auto it = unresolved.begin(); it != unresolved.end(); ++it) {
+        if (*it == node->id()) {
+          unresolved.erase(it);
+          break;
+        }
+      }
+      // The child's wait on the dropped node is replaced by one wait
+      // per ancestor it is not already linked against
+      uint64_t transferred = 0;
+      for (uint64_t ancestor_id : ancestors) {
+        if (find(unresolved.begin(), unresolved.end(), ancestor_id) !=
+            unresolved.end()) {
+          continue;
+        }
+        shared_ptr<ETFeederNode> parent = nullptr;
+        {
+          shared_lock<shared_mutex> lock(dep_graph_mutex_);
+          auto parent_node = dep_graph_.find(ancestor_id);
+          if (parent_node != dep_graph_.end()) {
+            parent = parent_node->second;
+          }
+        }
+        if (parent != nullptr) {
+          lock_guard<mutex> lock(dep_mutexes_[parent->id() % num_shards_]);
+          if (parent->addChild(child)) {
+            ++transferred;
+          }
+        } else {
+          unresolved.push_back(ancestor_id);
+          dep_waiters_[ancestor_id].emplace_back(child);
+          ++transferred;
+        }
+      }
+      child->setRemainingDeps(child->getRemainingDeps() + transferred - 1);
+      child->setDepUnresolvedParentIDs(unresolved);
+      if (unresolved.empty()) {
+        dep_unresolved_node_set_.erase(child);
+      }
+    }
+    dep_waiters_.erase(waiters);
+  }
+
+  filtered_dep_remap_[node->id()] = std::move(ancestors);
+  ++stat_nodes_filtered_;
+}
+
+bool ETFeeder::loadCacheHeader() {
+  const string cache_filename = filename_ + ".gcache";
+  cache_in_.open(cache_filename.c_str(), ios::in | ios::binary);
+  if (!cache_in_.good()) {
+    return false;
+  }
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t trace_size = 0;
+  uint64_t trace_mtime = 0;
+  uint64_t num_nodes = 0;
+  cache_in_.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  cache_in_.read(reinterpret_cast<char*>(&version), sizeof(version));
+  cache_in_.read(reinterpret_cast<char*>(&trace_size), sizeof(trace_size));
+  cache_in_.read(reinterpret_cast<char*>(&trace_mtime), sizeof(trace_mtime));
+  cache_in_.read(reinterpret_cast<char*>(&num_nodes), sizeof(num_nodes));
+  if (!cache_in_.good() || (magic != cache_magic) ||
+      (version != cache_version)) {
+    cache_in_.close();
+    return false;
+  }
+
+  // A size or mtime mismatch means the trace was rewritten since the
+  // cache was built, so the preprocessed records are stale
+  uint64_t size = 0;
+  uint64_t mtime = 0;
+  if (!traceStat(filename_, size, mtime) || (size != trace_size) ||
+      (mtime != trace_mtime)) {
+    cache_in_.close();
+    return false;
+  }
+
+  cache_nodes_total_ = num_nodes;
+  return true;
+}
+
+void ETFeeder::startCacheWrite() {
+  // Build the cache alongside the streaming load into a temp file; it
+  // is published under its final name only once the whole trace has
+  // been read
+  cache_out_.open(
+      (filename_ + ".gcache.tmp").c_str(),
+      ios::out | ios::binary | ios::trunc);
+  if (!cache_out_.good()) {
+    // A read-only trace directory just means the next open parses the
+    // trace again
+    return;
+  }
+
+  uint64_t size = 0;
+  uint64_t mtime = 0;
+  traceStat(filename_, size, mtime);
+  uint64_t num_nodes = 0; // patched in finalizeCacheWrite
+  cache_out_.write(
+      reinterpret_cast<const char*>(&cache_magic), sizeof(cache_magic));
+  cache_out_.write(
+      reinterpret_cast<const char*>(&cache_version), sizeof(cache_version));
+  cache_out_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  cache_out_.write(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+  cache_out_.write(reinterpret_cast<const char*>(&num_nodes), sizeof(num_nodes));
+  cache_write_active_ = true;
+}
+
+void ETFeeder::finalizeCacheWrite() {
+  cache_write_active_ = false;
+  // Patch the node count into the header, then publish the cache with
+  // an atomic rename so a concurrent open never sees a partial file
+  cache_out_.seekp(
+      sizeof(cache_magic) + sizeof(cache_version) + 2 * sizeof(uint64_t),
+      ios::beg);
+  cache_out_.write(
+      reinterpret_cast<const char*>(&cache_nodes_written_),
+      sizeof(cache_nodes_written_));
+  bool write_ok = cache_out_.good();
+  cache_out_.close();
+  if (write_ok) {
+    rename(
+        (filename_ + ".gcache.tmp").c_str(),
+        (filename_ + ".gcache").c_str());
+  } else {
+    remove((filename_ + ".gcache.tmp").c_str());
+  }
+}
+
+shared_ptr<ETFeederNode> ETFeeder::readCachedNode() {
+  if (cache_nodes_loaded_ >= cache_nodes_total_) {
+    return nullptr;
+  }
+
+  ETFeederNode* raw = nullptr;
+  {
+    lock_guard<mutex> lock(node_pool_->mutex);
+    if (!node_pool_->free_list.empty()) {
+      raw = node_pool_->free_list.back();
+      node_pool_->free_list.pop_back();
+    }
+  }
+  if (raw == nullptr) {
+    raw = new ETFeederNode();
+  }
 
+  if (!raw->reinitFromCache(cache_in_)) {
+    // A record count that does not match the header means the cache is
+    // corrupt; stop here and let what has been linked so far replay
+    {
+      lock_guard<mutex> lock(node_pool_->mutex);
+      node_pool_->free_list.push_back(raw);
+    }
+    cache_nodes_total_ = cache_nodes_loaded_;
+    return nullptr;
+  }
+  ++cache_nodes_loaded_;
+
+  shared_ptr<NodePool> pool = node_pool_;
+  shared_ptr<ETFeederNode> node(raw, [pool](ETFeederNode* node) {
+    node->recycle();
+    lock_guard<mutex> lock(pool->mutex);
+    pool->free_list.push_back(node);
+  });
+
+  // Linking happens in readNode, over the dependency ids carried by
+  // the cache record, so the filter applies to cached loads as well
   return node;
 }
 
+void ETFeeder::resolveWaiters(shared_ptr<ETFeederNode> parent) {
+  auto it = dep_waiters_.find(parent->id());
+  if (it == dep_waiters_.end()) {
+    return;
+  }
+
+  for (auto& child : it->second) {
+    {
+      lock_guard<mutex> lock(dep_mutexes_[parent->id() % num_shards_]);
+      parent->addChild(child);
+    }
+    vector<uint64_t> dep_unresolved_parent_ids =
+        child->getDepUnresolvedParentIDs();
+    for (auto inner_it = dep_unresolved_parent_ids.begin();
+         inner_it != dep_unresolved_parent_ids.end();
+         ++inner_it) {
+      if (*inner_it == parent->id()) {
+        dep_unresolved_parent_ids.erase(inner_it);
+        break;
+      }
+    }
+    child->setDepUnresolvedParentIDs(dep_unresolved_parent_ids);
+    if (dep_unresolved_parent_ids.size() == 0) {
+      dep_unresolved_node_set_.erase(child);
+    }
+  }
+  dep_waiters_.erase(it);
+}
+
 void ETFeeder::resolveDep() {
+  auto start = chrono::steady_clock::now();
   for (auto it = dep_unresolved_node_set_.begin();
        it != dep_unresolved_node_set_.end();) {
     shared_ptr<ETFeederNode> node = *it;
@@ -126,9 +1076,17 @@ void ETFeeder::resolveDep() {
         node->getDepUnresolvedParentIDs();
     for (auto inner_it = dep_unresolved_parent_ids.begin();
          inner_it != dep_unresolved_parent_ids.end();) {
-      auto parent_node = dep_graph_.find(*inner_it);
-      if (parent_node != dep_graph_.end()) {
-        parent_node->second->addChild(node);
+      shared_ptr<ETFeederNode> parent = nullptr;
+      {
+        shared_lock<shared_mutex> lock(dep_graph_mutex_);
+        auto parent_node = dep_graph_.find(*inner_it);
+        if (parent_node != dep_graph_.end()) {
+          parent = parent_node->second;
+        }
+      }
+      if (parent != nullptr) {
+        lock_guard<mutex> lock(dep_mutexes_[parent->id() % num_shards_]);
+        parent->addChild(node);
         inner_it = dep_unresolved_parent_ids.erase(inner_it);
       } else {
         ++inner_it;
@@ -141,6 +1099,7 @@ void ETFeeder::resolveDep() {
       ++it;
     }
   }
+  stat_resolve_dep_time_us_ += elapsedUs(start);
 }
 
 void ETFeeder::readNextWindow() {
@@ -148,27 +1107,331 @@ void ETFeeder::readNextWindow() {
     throw runtime_error(
         "Trace file closed unexpectedly during reading next window.");
   }
+  auto start = chrono::steady_clock::now();
   uint32_t num_read = 0;
   do {
     shared_ptr<ETFeederNode> new_node = readNode();
     if (new_node == nullptr) {
       et_complete_ = true;
+      if (cache_write_active_) {
+        // The whole trace has been decoded, so the cache is complete
+        finalizeCacheWrite();
+      }
       break;
     }
 
     addNode(new_node);
     ++num_read;
 
-    resolveDep();
+    // Only the children actually waiting on this node need linking
+    resolveWaiters(new_node);
   } while ((num_read < window_size_) || (dep_unresolved_node_set_.size() != 0));
 
-  for (auto node_id_node : dep_graph_) {
-    uint64_t node_id = node_id_node.first;
+  {
+    shared_lock<shared_mutex> lock(dep_graph_mutex_);
+    for (auto node_id_node : dep_graph_) {
+      uint64_t node_id = node_id_node.first;
+      shared_ptr<ETFeederNode> node = node_id_node.second;
+      if (!depFreeContains(node_id) && (node->getRemainingDeps() == 0)) {
+        pushDepFree(node);
+      }
+    }
+  }
+
+  stat_nodes_read_ += num_read;
+  stat_read_window_time_us_ += elapsedUs(start);
+  uint64_t refills = ++stat_window_refills_;
+  if ((stats_dump_interval_ != 0) && (refills % stats_dump_interval_ == 0)) {
+    dumpStats(cerr);
+  }
+}
+
+void ETFeeder::snapshot(ostream& out) {
+  // No window may be refilled while the state is being externalized
+  lock_guard<mutex> refill_lock(window_refill_mutex_);
+  shared_lock<shared_mutex> lock(dep_graph_mutex_);
+
+  uint64_t trace_size = 0;
+  uint64_t trace_mtime = 0;
+  traceStat(filename_, trace_size, trace_mtime);
+  out.write(
+      reinterpret_cast<const char*>(&snapshot_magic), sizeof(snapshot_magic));
+  out.write(
+      reinterpret_cast<const char*>(&snapshot_version),
+      sizeof(snapshot_version));
+  out.write(reinterpret_cast<const char*>(&trace_size), sizeof(trace_size));
+  out.write(reinterpret_cast<const char*>(&trace_mtime), sizeof(trace_mtime));
+
+  uint8_t complete = et_complete_ ? 1 : 0;
+  uint64_t consumed = stat_nodes_read_;
+  uint64_t filtered = stat_nodes_filtered_;
+  out.write(reinterpret_cast<const char*>(&complete), sizeof(complete));
+  out.write(reinterpret_cast<const char*>(&consumed), sizeof(consumed));
+  out.write(reinterpret_cast<const char*>(&filtered), sizeof(filtered));
+  out.write(
+      reinterpret_cast<const char*>(&consumed_offset_),
+      sizeof(consumed_offset_));
+
+  // The live window: each node's cache record plus the dependency
+  // state that has mutated since it was read
+  uint64_t num_nodes = dep_graph_.size();
+  out.write(reinterpret_cast<const char*>(&num_nodes), sizeof(num_nodes));
+  for (auto& node_id_node : dep_graph_) {
+    shared_ptr<ETFeederNode> node = node_id_node.second;
+    node->writeCacheRecord(out);
+    uint64_t remaining = node->getRemainingDeps();
+    out.write(reinterpret_cast<const char*>(&remaining), sizeof(remaining));
+    vector<uint64_t> unresolved = node->getDepUnresolvedParentIDs();
+    uint32_t num_unresolved = static_cast<uint32_t>(unresolved.size());
+    out.write(
+        reinterpret_cast<const char*>(&num_unresolved),
+        sizeof(num_unresolved));
+    for (uint64_t parent_id : unresolved) {
+      out.write(reinterpret_cast<const char*>(&parent_id), sizeof(parent_id));
+    }
+  }
+
+  // The filter's remap table, so reads resumed past the snapshot keep
+  // rewiring dependencies on already-dropped nodes; empty without a
+  // filter
+  uint64_t num_remap = filtered_dep_remap_.size();
+  out.write(reinterpret_cast<const char*>(&num_remap), sizeof(num_remap));
+  for (auto& dropped_ancestors : filtered_dep_remap_) {
+    uint64_t dropped_id = dropped_ancestors.first;
+    out.write(reinterpret_cast<const char*>(&dropped_id), sizeof(dropped_id));
+    uint32_t num_ancestors =
+        static_cast<uint32_t>(dropped_ancestors.second.size());
+    out.write(
+        reinterpret_cast<const char*>(&num_ancestors), sizeof(num_ancestors));
+    for (uint64_t ancestor_id : dropped_ancestors.second) {
+      out.write(
+          reinterpret_cast<const char*>(&ancestor_id), sizeof(ancestor_id));
+    }
+  }
+}
+
+bool ETFeeder::restore(istream& in) {
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint64_t trace_size = 0;
+  uint64_t trace_mtime = 0;
+  in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char*>(&version), sizeof(version));
+  in.read(reinterpret_cast<char*>(&trace_size), sizeof(trace_size));
+  in.read(reinterpret_cast<char*>(&trace_mtime), sizeof(trace_mtime));
+  if (!in.good() || (magic != snapshot_magic) ||
+      (version != snapshot_version)) {
+    return false;
+  }
+  uint64_t size = 0;
+  uint64_t mtime = 0;
+  if (!traceStat(filename_, size, mtime) || (size != trace_size) ||
+      (mtime != trace_mtime)) {
+    return false;
+  }
+
+  uint8_t complete = 0;
+  uint64_t consumed = 0;
+  uint64_t filtered = 0;
+  uint64_t offset = 0;
+  uint64_t num_nodes = 0;
+  in.read(reinterpret_cast<char*>(&complete), sizeof(complete));
+  in.read(reinterpret_cast<char*>(&consumed), sizeof(consumed));
+  in.read(reinterpret_cast<char*>(&filtered), sizeof(filtered));
+  in.read(reinterpret_cast<char*>(&offset), sizeof(offset));
+  in.read(reinterpret_cast<char*>(&num_nodes), sizeof(num_nodes));
+  if (!in.good()) {
+    return false;
+  }
+
+  // The decode pipeline is stopped and restarted at the restored
+  // position rather than repositioned in flight
+  stopPipeline();
+  raw_records_.clear();
+  parsed_msgs_.clear();
+  next_split_seq_ = 0;
+  next_consume_seq_ = 0;
+  trace_eof_ = false;
+
+  dep_graph_.clear();
+  dep_waiters_.clear();
+  dep_unresolved_node_set_.clear();
+  for (auto& shard : dep_free_shards_) {
+    shard.queue = DepFreeBucketQueue{};
+  }
+  et_complete_ = complete != 0;
+  stat_nodes_read_ = consumed;
+  stat_nodes_filtered_ = filtered;
+  stat_queue_depth_ = 0;
+  filtered_dep_remap_.clear();
+
+  // An in-progress cache build is aborted: its records no longer line
+  // up with the restored stream position
+  if (cache_write_active_) {
+    cache_write_active_ = false;
+    cache_out_.close();
+    remove((filename_ + ".gcache.tmp").c_str());
+  }
+
+  for (uint64_t i = 0; i < num_nodes; ++i) {
+    ETFeederNode* raw = nullptr;
+    {
+      lock_guard<mutex> lock(node_pool_->mutex);
+      if (!node_pool_->free_list.empty()) {
+        raw = node_pool_->free_list.back();
+        node_pool_->free_list.pop_back();
+      }
+    }
+    if (raw == nullptr) {
+      raw = new ETFeederNode();
+    }
+    bool record_ok = raw->reinitFromCache(in);
+    uint64_t remaining = 0;
+    in.read(reinterpret_cast<char*>(&remaining), sizeof(remaining));
+    uint32_t num_unresolved = 0;
+    in.read(
+        reinterpret_cast<char*>(&num_unresolved), sizeof(num_unresolved));
+    vector<uint64_t> unresolved;
+    for (uint32_t j = 0; j < num_unresolved; ++j) {
+      uint64_t parent_id = 0;
+      in.read(reinterpret_cast<char*>(&parent_id), sizeof(parent_id));
+      unresolved.push_back(parent_id);
+    }
+    if (!record_ok || !in.good()) {
+      lock_guard<mutex> lock(node_pool_->mutex);
+      node_pool_->free_list.push_back(raw);
+      return false;
+    }
+    raw->setRemainingDeps(remaining);
+    raw->setDepUnresolvedParentIDs(unresolved);
+
+    shared_ptr<NodePool> pool = node_pool_;
+    shared_ptr<ETFeederNode> node(raw, [pool](ETFeederNode* node) {
+      node->recycle();
+      lock_guard<mutex> lock(pool->mutex);
+      pool->free_list.push_back(node);
+    });
+    dep_graph_[node->id()] = node;
+  }
+
+  uint64_t num_remap = 0;
+  in.read(reinterpret_cast<char*>(&num_remap), sizeof(num_remap));
+  for (uint64_t i = 0; i < num_remap; ++i) {
+    uint64_t dropped_id = 0;
+    uint32_t num_ancestors = 0;
+    in.read(reinterpret_cast<char*>(&dropped_id), sizeof(dropped_id));
+    in.read(reinterpret_cast<char*>(&num_ancestors), sizeof(num_ancestors));
+    vector<uint64_t> ancestors;
+    for (uint32_t j = 0; j < num_ancestors; ++j) {
+      uint64_t ancestor_id = 0;
+      in.read(reinterpret_cast<char*>(&ancestor_id), sizeof(ancestor_id));
+      ancestors.push_back(ancestor_id);
+    }
+    filtered_dep_remap_[dropped_id] = std::move(ancestors);
+  }
+  if (!in.good()) {
+    return false;
+  }
+
+  // Relink: a dependency id maps to a live parent, an unresolved
+  // (not-yet-read) parent, or an already retired one, in which case
+  // the saved remaining count already reflects the release
+  for (auto& node_id_node : dep_graph_) {
     shared_ptr<ETFeederNode> node = node_id_node.second;
-    if ((dep_free_node_id_set_.count(node_id) == 0) &&
-        (node->getChakraNode()->data_deps().size() == 0)) {
-      dep_free_node_id_set_.emplace(node_id);
-      dep_free_node_queue_.emplace(node);
+    vector<uint64_t> unresolved = node->getDepUnresolvedParentIDs();
+    const vector<uint64_t>* deps = &node->data_deps();
+    vector<uint64_t> remapped;
+    if (filter_) {
+      // Rewired edges point at retained ancestors, not at the ids in
+      // data_deps, so the relink has to go through the remap table too
+      remapDeps(node->data_deps(), remapped);
+      deps = &remapped;
+    }
+    for (uint64_t dep_id : *deps) {
+      if (find(unresolved.begin(), unresolved.end(), dep_id) !=
+          unresolved.end()) {
+        dep_waiters_[dep_id].emplace_back(node);
+      } else {
+        auto parent = dep_graph_.find(dep_id);
+        if (parent != dep_graph_.end()) {
+          parent->second->addChild(node);
+        }
+      }
+    }
+    if (!unresolved.empty()) {
+      dep_unresolved_node_set_.emplace(node);
+    }
+  }
+
+  // Reposition the input at the first unconsumed node
+  if (cache_mode_) {
+    cache_in_.clear();
+    cache_in_.seekg(
+        sizeof(cache_magic) + sizeof(cache_version) + 3 * sizeof(uint64_t),
+        ios::beg);
+    // Filtered nodes were read off the cache too, so the skim covers
+    // retained and dropped records alike
+    ETFeederNode skim_node;
+    for (uint64_t i = 0; i < consumed + filtered; ++i) {
+      if (!skim_node.reinitFromCache(cache_in_)) {
+        return false;
+      }
+    }
+    cache_nodes_loaded_ = consumed + filtered;
+  } else {
+    lock_guard<mutex> lock(trace_mutex_);
+    if (!trace_.seek(offset)) {
+      return false;
+    }
+    consumed_offset_ = offset;
+  }
+
+  // Every node whose dependencies have all retired is issuable again,
+  // including nodes that were issued but not retired before the
+  // snapshot
+  for (auto& node_id_node : dep_graph_) {
+    if (node_id_node.second->getRemainingDeps() == 0) {
+      pushDepFree(node_id_node.second);
     }
   }
+
+  if (prefetch_enabled_ && !et_complete_) {
+    startPipeline();
+  }
+  return true;
+}
+
+ETFeederStats ETFeeder::getStats() const {
+  ETFeederStats stats;
+  stats.nodes_read = stat_nodes_read_;
+  stats.nodes_filtered = stat_nodes_filtered_;
+  stats.nodes_issued = stat_nodes_issued_;
+  stats.nodes_retired = stat_nodes_retired_;
+  stats.window_refills = stat_window_refills_;
+  stats.window_refill_stalls = stat_refill_stalls_;
+  stats.dep_free_queue_high_watermark = stat_queue_high_watermark_;
+  stats.read_window_time_us = stat_read_window_time_us_;
+  stats.resolve_dep_time_us = stat_resolve_dep_time_us_;
+  stats.free_children_time_us = stat_free_children_time_us_;
+  return stats;
+}
+
+void ETFeeder::enableStatsDump(uint32_t every_n_windows) {
+  stats_dump_interval_ = every_n_windows;
+}
+
+void ETFeeder::dumpStats(ostream& out) const {
+  ETFeederStats stats = getStats();
+  out << "ETFeeder stats (" << filename_ << "):"
+      << " nodes_read=" << stats.nodes_read
+      << " nodes_filtered=" << stats.nodes_filtered
+      << " nodes_issued=" << stats.nodes_issued
+      << " nodes_retired=" << stats.nodes_retired
+      << " window_refills=" << stats.window_refills
+      << " window_refill_stalls=" << stats.window_refill_stalls
+      << " dep_free_queue_high_watermark="
+      << stats.dep_free_queue_high_watermark
+      << " read_window_time_us=" << stats.read_window_time_us
+      << " resolve_dep_time_us=" << stats.resolve_dep_time_us
+      << " free_children_time_us=" << stats.free_children_time_us << endl;
 }
\ No newline at end of file
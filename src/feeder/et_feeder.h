@@ -1,56 +1,307 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
 #include <memory>
-#include <queue>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <google/protobuf/arena.h>
+
 #include "et_feeder/et_feeder_node.h"
 #include "third_party/utils/protoio.hh"
 
 namespace Chakra {
-struct CompareNodes : public std::binary_function<
-                          std::shared_ptr<ETFeederNode>,
-                          std::shared_ptr<ETFeederNode>,
-                          bool> {
-  bool operator()(
-      const std::shared_ptr<ETFeederNode> lhs,
-      const std::shared_ptr<ETFeederNode> rhs) const {
-    return lhs->getChakraNode()->id() > rhs->getChakraNode()->id();
+
+// Snapshot of the feeder's instrumentation counters. Counters are
+// aggregated per call or per window, never per decoded byte, so the
+// accounting is cheap enough to stay on in production
+struct ETFeederStats {
+  uint64_t nodes_read;
+  uint64_t nodes_filtered;
+  uint64_t nodes_issued;
+  uint64_t nodes_retired;
+  uint64_t window_refills;
+  uint64_t window_refill_stalls;
+  uint64_t dep_free_queue_high_watermark;
+  uint64_t read_window_time_us;
+  uint64_t resolve_dep_time_us;
+  uint64_t free_children_time_us;
+};
+
+// Predicate deciding whether a decoded node is kept; nodes it rejects
+// are dropped at decode time and never enter the dependency graph
+using NodeFilter = std::function<bool(ETFeederNode&)>;
+
+// Dep-free nodes are kept in a bucketed key-ordered queue instead of
+// a binary heap mirrored by a membership hash set. Keys arrive
+// roughly monotonically from the trace, so insertion, membership,
+// and min-extraction are all O(1) amortized: a bucket covers a
+// dense span of keys with an occupancy bitmap, and the minimum is
+// found with a bit scan instead of heap sifting
+struct DepFreeBucket {
+  static const uint32_t span_bits_ = 8;
+  static const uint64_t span_ = uint64_t(1) << span_bits_;
+  uint64_t base;
+  uint64_t count{0};
+  std::array<uint64_t, span_ / 64> occupied{};
+  std::vector<std::shared_ptr<ETFeederNode>> slots;
+  explicit DepFreeBucket(uint64_t base_key) : base(base_key), slots(span_) {}
+};
+
+class DepFreeBucketQueue {
+ public:
+  // Returns false if the key is already queued
+  bool insert(uint64_t key, std::shared_ptr<ETFeederNode> node);
+  bool contains(uint64_t key) const;
+  // Lowest-key node, or nullptr when the queue is empty
+  std::shared_ptr<ETFeederNode> top() const;
+  std::shared_ptr<ETFeederNode> popMin();
+  bool empty() const {
+    return count_ == 0;
+  }
+  uint64_t size() const {
+    return count_;
   }
+
+ private:
+  const DepFreeBucket* findBucket(uint64_t key) const;
+  DepFreeBucket& bucketFor(uint64_t key);
+  // Sorted by base key; pushes land at the back in the common
+  // monotonic case and drained leading buckets are pruned on pop
+  std::deque<std::unique_ptr<DepFreeBucket>> buckets_{};
+  uint64_t count_{0};
+};
+
+struct DepFreeShard {
+  std::mutex mutex;
+  // Keyed on id / the owner's shard count, which is dense within a
+  // shard
+  DepFreeBucketQueue queue{};
 };
 
 class ETFeeder {
  public:
-  ETFeeder(std::string filename);
+  // When keep_node is set, nodes it rejects are dropped in readNode,
+  // before addNode, and their data_deps are transitively rewired so
+  // the retained subgraph keeps the original ordering. Network-only
+  // studies can skip the compute nodes' graph cost this way
+  ETFeeder(
+      std::string filename,
+      bool enable_prefetch = true,
+      NodeFilter keep_node = NodeFilter{});
   ~ETFeeder();
 
   void addNode(std::shared_ptr<ETFeederNode> node);
   void removeNode(uint64_t node_id);
   bool hasNodesToIssue();
   std::shared_ptr<ETFeederNode> getNextIssuableNode();
+  // Pop up to max_nodes dep-free nodes into the caller-provided buffer
+  // in one call, lowest id first; returns the number popped. Amortizes
+  // the shard locking across the batch
+  uint64_t getNextIssuableNodes(
+      uint64_t max_nodes,
+      std::vector<std::shared_ptr<ETFeederNode>>& nodes);
+  // Batched retirement: frees the children of every node in the batch,
+  // erases them from the graph under one exclusive lock, and checks
+  // for a window refill once at the end
+  void retireNodes(const std::vector<uint64_t>& node_ids);
   void pushBackIssuableNode(uint64_t node_id);
   std::shared_ptr<ETFeederNode> lookupNode(uint64_t node_id);
+  std::shared_ptr<ETFeederNode> lookupNodeFromTrace(uint64_t node_id);
   void freeChildrenNodes(uint64_t node_id);
   void readGlobalMetadata();
   std::shared_ptr<ETFeederNode> readNode();
   void readNextWindow();
   void resolveDep();
+  // Serialize the feeder's resumable state: the consumed trace
+  // position plus every node currently in the dependency graph with
+  // its live dependency count. Callers must quiesce issuing and
+  // retiring threads around the call
+  void snapshot(std::ostream& out);
+  // Rebuild the feeder from a snapshot taken on the same trace;
+  // issued-but-unretired nodes become issuable again. A snapshot taken
+  // with a node filter must be restored into a feeder constructed with
+  // the same filter. Returns false on a stale or corrupt snapshot, in
+  // which case the feeder must be reconstructed before use
+  bool restore(std::istream& in);
+  // Stream offset just past the last node consumed into the graph;
+  // the anchor for a LookaheadScanner's second cursor. A cache-mode
+  // feeder never re-reads the trace, so there the offset stays at the
+  // start of the node stream and a synced scanner sees the whole trace
+  uint64_t consumedOffset() const {
+    return consumed_offset_;
+  }
+  ETFeederStats getStats() const;
+  // Dump the stats to stderr every every_n_windows window refills;
+  // 0 disables the periodic dump
+  void enableStatsDump(uint32_t every_n_windows);
+  void dumpStats(std::ostream& out) const;
 
  private:
+  // The dep-free structure is sharded by node id so worker threads
+  // simulating different pipelines can issue and retire nodes from the
+  // same feeder without funneling through one global mutex
+  static const uint32_t num_shards_ = 16;
+
+  // Freelist of retired node objects. Recycled nodes keep their
+  // container capacity, so steady-state window turnover allocates
+  // almost nothing. The pool is shared with the node deleters so it
+  // outlives the feeder if handed-out nodes do
+  struct NodePool {
+    std::mutex mutex;
+    std::vector<ETFeederNode*> free_list{};
+    ~NodePool() {
+      for (ETFeederNode* node : free_list) {
+        delete node;
+      }
+    }
+  };
+
+  void loadOrBuildIndex();
+  bool loadIndex(const std::string& index_filename);
+  void buildIndex(const std::string& index_filename);
+  bool loadCacheHeader();
+  void startCacheWrite();
+  void finalizeCacheWrite();
+  std::shared_ptr<ETFeederNode> readCachedNode();
+  void startPipeline();
+  void stopPipeline();
+  void splitterLoop();
+  void parserLoop();
+  std::shared_ptr<ChakraProtoMsg::Node> allocateNodeMsg();
+  std::shared_ptr<ChakraProtoMsg::Node> nextNodeMsg();
+  std::shared_ptr<ETFeederNode> allocateNode(
+      std::shared_ptr<ChakraProtoMsg::Node> pkt_msg);
+  DepFreeShard& shardFor(uint64_t node_id);
+  void linkNode(std::shared_ptr<ETFeederNode> node);
+  void remapDeps(const std::vector<uint64_t>& deps, std::vector<uint64_t>& out);
+  void dropFilteredNode(std::shared_ptr<ETFeederNode> node);
+  void resolveWaiters(std::shared_ptr<ETFeederNode> parent);
+  void pushDepFree(std::shared_ptr<ETFeederNode> node);
+  bool depFreeContains(uint64_t node_id);
+  uint64_t depFreeSize();
+
+  const std::string filename_;
   ProtoInputStream trace_;
+  // Optional predicate-pushdown filter; empty means keep everything
+  NodeFilter filter_{};
+  // Dropped node id -> its retained ancestor ids, consulted when later
+  // nodes name a dropped node in their data_deps. Entries are resolved
+  // transitively at lookup because a recorded ancestor may itself be
+  // dropped afterwards
+  std::unordered_map<uint64_t, std::vector<uint64_t>> filtered_dep_remap_{};
   const uint32_t window_size_;
-  bool et_complete_;
+  std::atomic<bool> et_complete_;
+  bool index_loaded_;
+
+  // Pipelined background decode: a splitter thread slices raw
+  // length-prefixed records off the trace, a pool of parser threads
+  // decodes them into messages in parallel, and the single consumer
+  // drains them in sequence order through a reorder buffer, so window
+  // load scales with cores instead of one decode thread
+  static const uint32_t num_parser_threads_ = 4;
+
+  struct RawRecord {
+    uint64_t seq;
+    // Stream offset just past the record, carried through the
+    // pipeline so checkpoints can externalize the consumed position
+    uint64_t end_offset;
+    std::string bytes;
+  };
+
+  bool prefetch_enabled_;
+  bool prefetch_stop_;
+  bool trace_eof_;
+  std::deque<RawRecord> raw_records_;
+  // Reorder buffer: sequence number -> (parsed message, end offset);
+  // a decode failure is delivered as a null message
+  std::unordered_map<
+      uint64_t,
+      std::pair<std::shared_ptr<ChakraProtoMsg::Node>, uint64_t>>
+      parsed_msgs_;
+  uint64_t next_split_seq_{0};
+  uint64_t next_consume_seq_{0};
+  // Offset just past the last node message consumed into the graph
+  uint64_t consumed_offset_{0};
+  std::mutex prefetch_mutex_;
+  std::mutex trace_mutex_;
+  // Arena message allocation is shared by the parser pool
+  std::mutex arena_mutex_;
+  std::condition_variable prefetch_fill_cv_;
+  std::condition_variable parse_cv_;
+  std::condition_variable prefetch_drain_cv_;
+  std::thread splitter_thread_;
+  std::vector<std::thread> parser_threads_;
+
+  std::unordered_map<uint64_t, uint64_t> node_offset_index_{};
+  // Serializes the lazy index build between concurrent
+  // lookupNodeFromTrace callers; the index is immutable once built
+  std::mutex index_mutex_;
+
+  // Preprocessed-graph cache: on the first complete load every decoded
+  // node is appended to a sidecar as its extracted fields and
+  // dependency ids; later opens of an unchanged trace rebuild the
+  // graph from the sidecar and skip protobuf parsing entirely
+  bool cache_mode_{false};
+  bool cache_write_active_{false};
+  std::ifstream cache_in_;
+  std::ofstream cache_out_;
+  uint64_t cache_nodes_total_{0};
+  uint64_t cache_nodes_loaded_{0};
+  uint64_t cache_nodes_written_{0};
+
+  // Node messages are arena-allocated one window at a time. Nodes
+  // extract everything they need and release their message in reinit,
+  // so the arena is freed in a single shot as soon as the window's
+  // messages have been consumed
+  std::shared_ptr<google::protobuf::Arena> arena_{nullptr};
+  uint32_t arena_alloc_count_{0};
+
+  std::shared_ptr<NodePool> node_pool_{std::make_shared<NodePool>()};
 
   std::unordered_map<uint64_t, std::shared_ptr<ETFeederNode>> dep_graph_{};
-  std::unordered_set<uint64_t> dep_free_node_id_set_{};
-  std::priority_queue<
-      std::shared_ptr<ETFeederNode>,
-      std::vector<std::shared_ptr<ETFeederNode>>,
-      CompareNodes>
-      dep_free_node_queue_{};
   std::unordered_set<std::shared_ptr<ETFeederNode>> dep_unresolved_node_set_{};
+  // Reverse index: pending parent id -> children waiting on it, so a
+  // newly added node resolves only its actual waiters instead of the
+  // loader rescanning every unresolved node per read
+  std::unordered_map<uint64_t, std::vector<std::shared_ptr<ETFeederNode>>>
+      dep_waiters_{};
+
+  // dep_graph_ is guarded by a reader-writer lock; lookups and dep
+  // resolution take it shared, insert/erase take it exclusive
+  mutable std::shared_mutex dep_graph_mutex_;
+  std::array<DepFreeShard, num_shards_> dep_free_shards_{};
+  // Per-id-shard mutexes serializing child dependency updates between
+  // concurrent retirements and the window loader
+  std::array<std::mutex, num_shards_> dep_mutexes_{};
+  // Only one thread refills the window at a time; contenders skip
+  std::mutex window_refill_mutex_;
+
+  // Instrumentation counters; atomics because issue and retire may run
+  // on worker threads. Times are cumulative microseconds per phase
+  std::atomic<uint64_t> stat_nodes_read_{0};
+  std::atomic<uint64_t> stat_nodes_filtered_{0};
+  std::atomic<uint64_t> stat_nodes_issued_{0};
+  std::atomic<uint64_t> stat_nodes_retired_{0};
+  std::atomic<uint64_t> stat_window_refills_{0};
+  std::atomic<uint64_t> stat_refill_stalls_{0};
+  std::atomic<uint64_t> stat_queue_depth_{0};
+  std::atomic<uint64_t> stat_queue_high_watermark_{0};
+  std::atomic<uint64_t> stat_read_window_time_us_{0};
+  std::atomic<uint64_t> stat_resolve_dep_time_us_{0};
+  std::atomic<uint64_t> stat_free_children_time_us_{0};
+  uint32_t stats_dump_interval_{0};
 };
 
 } // namespace Chakra
\ No newline at end of file
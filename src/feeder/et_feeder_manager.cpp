@@ -0,0 +1,89 @@
+#include "et_feeder/et_feeder_manager.h"
+
+#include <atomic>
+#include <stdexcept>
+
+using namespace std;
+using namespace Chakra;
+
+ETFeederManager::ETFeederManager(
+    vector<string> filenames,
+    uint32_t num_threads) {
+  loadAll(filenames, num_threads);
+}
+
+ETFeederManager::ETFeederManager(
+    string filename_prefix,
+    uint32_t num_ranks,
+    uint32_t num_threads) {
+  // Per-rank traces follow the <prefix>.<rank>.et naming convention
+  // used by the converters
+  vector<string> filenames;
+  filenames.reserve(num_ranks);
+  for (uint32_t rank = 0; rank < num_ranks; ++rank) {
+    filenames.emplace_back(filename_prefix + "." + to_string(rank) + ".et");
+  }
+  loadAll(filenames, num_threads);
+}
+
+void ETFeederManager::loadAll(
+    const vector<string>& filenames,
+    uint32_t num_threads) {
+  feeders_.resize(filenames.size());
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  if (num_threads > filenames.size()) {
+    num_threads = filenames.size();
+  }
+
+  // Each ETFeeder constructor decodes global metadata plus the first
+  // window, so warming thousands of ranks serially dominates startup;
+  // fan the constructions out over a thread pool instead
+  atomic<size_t> next_rank(0);
+  mutex error_mutex;
+  exception_ptr first_error = nullptr;
+
+  auto worker = [&]() {
+    while (true) {
+      size_t rank = next_rank.fetch_add(1);
+      if (rank >= filenames.size()) {
+        return;
+      }
+      try {
+        feeders_[rank] = make_shared<ETFeeder>(filenames[rank]);
+      } catch (...) {
+        lock_guard<mutex> lock(error_mutex);
+        if (first_error == nullptr) {
+          first_error = current_exception();
+        }
+      }
+    }
+  };
+
+  vector<thread> pool;
+  pool.reserve(num_threads);
+  for (uint32_t i = 0; i < num_threads; ++i) {
+    pool.emplace_back(worker);
+  }
+  for (auto& t : pool) {
+    t.join();
+  }
+
+  if (first_error != nullptr) {
+    rethrow_exception(first_error);
+  }
+}
+
+shared_ptr<ETFeeder> ETFeederManager::getFeeder(uint32_t rank) {
+  if (rank >= feeders_.size()) {
+    throw out_of_range(
+        "rank=" + to_string(rank) + " out of range, manager owns " +
+        to_string(feeders_.size()) + " feeders");
+  }
+  return feeders_[rank];
+}
+
+uint32_t ETFeederManager::numRanks() const {
+  return feeders_.size();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "et_feeder/et_feeder.h"
+
+namespace Chakra {
+
+class ETFeederManager {
+ public:
+  ETFeederManager(
+      std::vector<std::string> filenames,
+      uint32_t num_threads = std::thread::hardware_concurrency());
+  ETFeederManager(
+      std::string filename_prefix,
+      uint32_t num_ranks,
+      uint32_t num_threads = std::thread::hardware_concurrency());
+
+  std::shared_ptr<ETFeeder> getFeeder(uint32_t rank);
+  uint32_t numRanks() const;
+
+ private:
+  void loadAll(const std::vector<std::string>& filenames, uint32_t num_threads);
+
+  std::vector<std::shared_ptr<ETFeeder>> feeders_{};
+};
+
+} // namespace Chakra
@@ -1,59 +1,302 @@
 #include "et_feeder/et_feeder_node.h"
 
+#include <stdexcept>
+
+#include "et_feeder/string_pool.h"
+
 using namespace std;
 using namespace Chakra;
 
+// Dense tags for the attributes the feeder extracts into members, so
+// per-node dispatch is a single hash probe plus an integer switch
+// instead of a chain of string comparisons per attribute
+enum AttrTag {
+  ATTR_IS_CPU_OP,
+  ATTR_NUM_OPS,
+  ATTR_TENSOR_SIZE,
+  ATTR_COMM_TYPE,
+  ATTR_INVOLVED_DIM,
+  ATTR_COMM_PRIORITY,
+  ATTR_COMM_SIZE,
+  ATTR_COMM_SRC,
+  ATTR_COMM_DST,
+  ATTR_COMM_TAG,
+  ATTR_OTHER
+};
+
+static AttrTag resolveAttrTag(const string& attr_name) {
+  // Resolved once per process; every node afterwards dispatches on the
+  // integer tag
+  static const unordered_map<string, AttrTag> attr_tag_map = {
+      {"is_cpu_op", ATTR_IS_CPU_OP},
+      {"num_ops", ATTR_NUM_OPS},
+      {"tensor_size", ATTR_TENSOR_SIZE},
+      {"comm_type", ATTR_COMM_TYPE},
+      {"involved_dim", ATTR_INVOLVED_DIM},
+      {"comm_priority", ATTR_COMM_PRIORITY},
+      {"comm_size", ATTR_COMM_SIZE},
+      {"comm_src", ATTR_COMM_SRC},
+      {"comm_dst", ATTR_COMM_DST},
+      {"comm_tag", ATTR_COMM_TAG}};
+  auto it = attr_tag_map.find(attr_name);
+  return (it == attr_tag_map.end()) ? ATTR_OTHER : it->second;
+}
+
+// Fixed-width raw scalar I/O for the preprocessed-graph cache records;
+// the same layout the feeder uses for its sidecar index header
+template <typename T>
+static void writeRaw(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool readRaw(std::istream& in, T& value) {
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return in.good();
+}
+
 ETFeederNode::ETFeederNode(std::shared_ptr<ChakraProtoMsg::Node> node) {
-  this->node_ = node;
+  reinit(node);
+}
+
+void ETFeederNode::recycle() {
+  this->children_set_.clear();
+  this->children_vec_.clear();
+  this->dep_unresolved_parent_ids_.clear();
+  this->data_deps_.clear();
+  // The attribute pointers refer into owned_attrs_, so they go
+  // together
+  this->other_attrs_.clear();
+  this->owned_attrs_.clear();
+}
+
+void ETFeederNode::reinit(std::shared_ptr<ChakraProtoMsg::Node> node) {
+  // clear() keeps the containers' capacity, which is the whole point
+  // of recycling node objects through the pool
+  this->children_set_.clear();
+  this->children_vec_.clear();
+  this->dep_unresolved_parent_ids_.clear();
+  this->other_attrs_.clear();
+  this->owned_attrs_.clear();
+  this->involved_dim_.clear();
+  this->num_ops_ = 0;
+  this->tensor_loc_ = 0;
+  this->tensor_size_ = 0;
+  this->comm_type_ = static_cast<ChakraProtoMsg::CollectiveCommType>(0);
+  this->involved_dim_size_ = 0;
+  this->comm_priority_ = 0;
+  this->comm_size_ = 0;
+  this->comm_src_ = 0;
+  this->comm_dst_ = 0;
+  this->comm_tag_ = 0;
+
   this->id_ = node->id();
-  this->name_ = node->name();
+  this->name_id_ = StringPool::instance().intern(node->name());
+  this->type_ = node->type();
   this->runtime_ = node->duration_micros();
   this->is_cpu_op_ = 1;
+  this->num_total_deps_ = node->data_deps_size();
+  this->num_remaining_deps_ = node->data_deps_size();
+  this->data_deps_.assign(
+      node->data_deps().begin(), node->data_deps().end());
 
   for (const auto& attr : node->attr()) {
-    const string& attr_name = attr.name();
-
-    if (attr_name == "is_cpu_op") {
-      this->is_cpu_op_ = static_cast<uint32_t>(attr.int32_val());
-    } else if (attr_name == "num_ops") {
-      this->num_ops_ = static_cast<uint64_t>(attr.int64_val());
-    } else if (attr_name == "tensor_size") {
-      this->tensor_size_ = attr.uint64_val();
-    } else if (attr_name == "comm_type") {
-      this->comm_type_ =
-          static_cast<ChakraProtoMsg::CollectiveCommType>(attr.int64_val());
-    } else if (attr_name == "involved_dim") {
-      this->involved_dim_.clear();
-      for (const bool val : attr.bool_list().values()) {
-        this->involved_dim_.push_back(val);
+    switch (resolveAttrTag(attr.name())) {
+      case ATTR_IS_CPU_OP:
+        // Encoded as a bool by newer converters and as an int32 by
+        // older ones
+        if (attr.value_case() == ChakraProtoMsg::AttributeProto::kBoolVal) {
+          this->is_cpu_op_ = static_cast<uint32_t>(attr.bool_val());
+        } else {
+          this->is_cpu_op_ = static_cast<uint32_t>(attr.int32_val());
+        }
+        break;
+      case ATTR_NUM_OPS:
+        this->num_ops_ = static_cast<uint64_t>(attr.int64_val());
+        break;
+      case ATTR_TENSOR_SIZE:
+        this->tensor_size_ = attr.uint64_val();
+        break;
+      case ATTR_COMM_TYPE:
+        this->comm_type_ =
+            static_cast<ChakraProtoMsg::CollectiveCommType>(attr.int64_val());
+        break;
+      case ATTR_INVOLVED_DIM:
+        this->involved_dim_.clear();
+        for (const bool val : attr.bool_list().values()) {
+          this->involved_dim_.push_back(val);
+        }
+        this->involved_dim_size_ = this->involved_dim_.size();
+        break;
+      case ATTR_COMM_PRIORITY:
+        this->comm_priority_ = static_cast<uint32_t>(attr.int32_val());
+        break;
+      case ATTR_COMM_SIZE:
+        this->comm_size_ = attr.uint64_val();
+        break;
+      case ATTR_COMM_SRC:
+        this->comm_src_ = static_cast<uint32_t>(attr.int32_val());
+        break;
+      case ATTR_COMM_DST:
+        this->comm_dst_ = static_cast<uint32_t>(attr.int32_val());
+        break;
+      case ATTR_COMM_TAG:
+        this->comm_tag_ = static_cast<uint32_t>(attr.int32_val());
+        break;
+      case ATTR_OTHER:
+        // Copied below once the count is known, so the message can be
+        // released instead of being pinned for its attr storage
+        break;
+    }
+  }
+
+  // Own the leftover attributes so nothing keeps the message alive;
+  // reserve first because other_attrs_ points into the vector
+  uint32_t num_other = 0;
+  for (const auto& attr : node->attr()) {
+    if (resolveAttrTag(attr.name()) == ATTR_OTHER) {
+      ++num_other;
+    }
+  }
+  if (num_other > 0) {
+    this->owned_attrs_.reserve(num_other);
+    for (const auto& attr : node->attr()) {
+      if (resolveAttrTag(attr.name()) == ATTR_OTHER) {
+        this->owned_attrs_.push_back(attr);
+        this->other_attrs_[attr.name()] = &this->owned_attrs_.back();
       }
-      this->involved_dim_size_ = this->involved_dim_.size();
-    } else if (attr_name == "comm_priority") {
-      this->comm_priority_ = static_cast<uint32_t>(attr.int32_val());
-    } else if (attr_name == "comm_size") {
-      this->comm_size_ = attr.uint64_val();
-    } else if (attr_name == "comm_src") {
-      this->comm_src_ = static_cast<uint32_t>(attr.int32_val());
-    } else if (attr_name == "comm_dst") {
-      this->comm_dst_ = static_cast<uint32_t>(attr.int32_val());
-    } else if (attr_name == "comm_tag") {
-      this->comm_tag_ = static_cast<uint32_t>(attr.int32_val());
     }
   }
 }
 
-shared_ptr<ChakraProtoMsg::Node> ETFeederNode::getChakraNode() {
-  return node_;
+void ETFeederNode::writeCacheRecord(std::ostream& out) {
+  writeRaw(out, id_);
+  const string& name = StringPool::instance().resolve(name_id_);
+  uint32_t name_len = static_cast<uint32_t>(name.size());
+  writeRaw(out, name_len);
+  out.write(name.data(), name_len);
+  writeRaw(out, static_cast<uint32_t>(type_));
+  writeRaw(out, is_cpu_op_);
+  writeRaw(out, runtime_);
+  writeRaw(out, num_ops_);
+  writeRaw(out, tensor_loc_);
+  writeRaw(out, tensor_size_);
+  writeRaw(out, static_cast<uint64_t>(comm_type_));
+  uint32_t num_dims = static_cast<uint32_t>(involved_dim_.size());
+  writeRaw(out, num_dims);
+  for (uint32_t i = 0; i < num_dims; ++i) {
+    uint8_t dim = involved_dim_[i] ? 1 : 0;
+    writeRaw(out, dim);
+  }
+  writeRaw(out, comm_priority_);
+  writeRaw(out, comm_size_);
+  writeRaw(out, comm_src_);
+  writeRaw(out, comm_dst_);
+  writeRaw(out, comm_tag_);
+
+  uint32_t num_deps = static_cast<uint32_t>(data_deps_.size());
+  writeRaw(out, num_deps);
+  for (uint32_t i = 0; i < num_deps; ++i) {
+    writeRaw(out, data_deps_[i]);
+  }
+
+  // Attributes without a dedicated member are kept verbatim as
+  // serialized AttributeProto messages so nothing is lost in the cache
+  uint32_t num_attrs = static_cast<uint32_t>(other_attrs_.size());
+  writeRaw(out, num_attrs);
+  for (const auto& entry : other_attrs_) {
+    string bytes = entry.second->SerializeAsString();
+    uint32_t attr_len = static_cast<uint32_t>(bytes.size());
+    writeRaw(out, attr_len);
+    out.write(bytes.data(), attr_len);
+  }
+}
+
+bool ETFeederNode::reinitFromCache(std::istream& in) {
+  this->children_set_.clear();
+  this->children_vec_.clear();
+  this->dep_unresolved_parent_ids_.clear();
+  this->data_deps_.clear();
+  this->other_attrs_.clear();
+  this->owned_attrs_.clear();
+  this->involved_dim_.clear();
+
+  if (!readRaw(in, id_)) {
+    return false;
+  }
+  uint32_t name_len = 0;
+  if (!readRaw(in, name_len)) {
+    return false;
+  }
+  string name(name_len, '\0');
+  in.read(&name[0], name_len);
+  name_id_ = StringPool::instance().intern(name);
+  uint32_t type_val = 0;
+  readRaw(in, type_val);
+  type_ = static_cast<ChakraProtoMsg::NodeType>(type_val);
+  readRaw(in, is_cpu_op_);
+  readRaw(in, runtime_);
+  readRaw(in, num_ops_);
+  readRaw(in, tensor_loc_);
+  readRaw(in, tensor_size_);
+  uint64_t comm_type_val = 0;
+  readRaw(in, comm_type_val);
+  comm_type_ = static_cast<ChakraProtoMsg::CollectiveCommType>(comm_type_val);
+  uint32_t num_dims = 0;
+  readRaw(in, num_dims);
+  for (uint32_t i = 0; i < num_dims; ++i) {
+    uint8_t dim = 0;
+    readRaw(in, dim);
+    involved_dim_.push_back(dim != 0);
+  }
+  involved_dim_size_ = involved_dim_.size();
+  readRaw(in, comm_priority_);
+  readRaw(in, comm_size_);
+  readRaw(in, comm_src_);
+  readRaw(in, comm_dst_);
+  readRaw(in, comm_tag_);
+
+  uint32_t num_deps = 0;
+  readRaw(in, num_deps);
+  for (uint32_t i = 0; i < num_deps; ++i) {
+    uint64_t dep_id = 0;
+    readRaw(in, dep_id);
+    data_deps_.push_back(dep_id);
+  }
+  num_total_deps_ = num_deps;
+  num_remaining_deps_ = num_deps;
+
+  uint32_t num_attrs = 0;
+  readRaw(in, num_attrs);
+  // reserve() keeps the attribute pointers stable while the vector is
+  // filled
+  owned_attrs_.reserve(num_attrs);
+  for (uint32_t i = 0; i < num_attrs; ++i) {
+    uint32_t attr_len = 0;
+    readRaw(in, attr_len);
+    string bytes(attr_len, '\0');
+    in.read(&bytes[0], attr_len);
+    owned_attrs_.emplace_back();
+    if (!owned_attrs_.back().ParseFromString(bytes)) {
+      return false;
+    }
+  }
+  for (const auto& attr : owned_attrs_) {
+    other_attrs_[attr.name()] = &attr;
+  }
+  return in.good();
 }
 
-void ETFeederNode::addChild(shared_ptr<ETFeederNode> node) {
+bool ETFeederNode::addChild(shared_ptr<ETFeederNode> node) {
   // Avoid adding the same child node multiple times
-  // addChild is called multiple times to resolve dependencies
+  // addChild is called multiple times to resolve dependencies.
+  // Returns whether the child was newly linked
   if (children_set_.find(node) != children_set_.end()) {
-    return;
+    return false;
   }
   children_vec_.emplace_back(node);
   children_set_.emplace(node);
+  return true;
 }
 
 vector<shared_ptr<ETFeederNode>> ETFeederNode::getChildren() {
@@ -73,12 +316,40 @@ void ETFeederNode::setDepUnresolvedParentIDs(
   dep_unresolved_parent_ids_ = dep_unresolved_parent_ids;
 }
 
+uint64_t ETFeederNode::getRemainingDeps() {
+  return num_remaining_deps_.load();
+}
+
+bool ETFeederNode::releaseDependency() {
+  // Returns true for exactly the release that drops the count to
+  // zero; further calls on an already dep-free node are no-ops
+  uint64_t cur = num_remaining_deps_.load();
+  while (cur != 0) {
+    if (num_remaining_deps_.compare_exchange_weak(cur, cur - 1)) {
+      return cur == 1;
+    }
+  }
+  return false;
+}
+
+void ETFeederNode::resetRemainingDeps() {
+  num_remaining_deps_ = num_total_deps_;
+}
+
+void ETFeederNode::setRemainingDeps(uint64_t remaining_deps) {
+  num_remaining_deps_ = remaining_deps;
+}
+
+const vector<uint64_t>& ETFeederNode::data_deps() {
+  return data_deps_;
+}
+
 uint64_t ETFeederNode::id() {
   return id_;
 }
 
 string ETFeederNode::name() {
-  return name_;
+  return StringPool::instance().resolve(name_id_);
 }
 
 bool ETFeederNode::is_cpu_op() {
@@ -86,7 +357,7 @@ bool ETFeederNode::is_cpu_op() {
 }
 
 ChakraProtoMsg::NodeType ETFeederNode::type() {
-  return node_->type();
+  return type_;
 }
 
 uint64_t ETFeederNode::runtime() {
@@ -136,3 +407,18 @@ uint32_t ETFeederNode::comm_dst() {
 uint32_t ETFeederNode::comm_tag() {
   return comm_tag_;
 }
+
+bool ETFeederNode::has_other_attr(const string& attr_name) {
+  return other_attrs_.find(attr_name) != other_attrs_.end();
+}
+
+ChakraProtoMsg::AttributeProto ETFeederNode::get_other_attr(
+    const string& attr_name) {
+  auto it = other_attrs_.find(attr_name);
+  if (it == other_attrs_.end()) {
+    throw std::runtime_error(
+        "Asked for attr \"" + attr_name + "\" from node " +
+        std::to_string(id_) + ", however, this node does not have this attr");
+  }
+  return *it->second;
+}
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <istream>
 #include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -11,13 +16,38 @@ namespace Chakra {
 class ETFeederNode {
  public:
   ETFeederNode(std::shared_ptr<ChakraProtoMsg::Node> node);
-  std::shared_ptr<ChakraProtoMsg::Node> getChakraNode();
-  void addChild(std::shared_ptr<ETFeederNode> node);
+  // Pool construction path for cache loading; the object is only
+  // usable after reinit() or reinitFromCache()
+  ETFeederNode() = default;
+  // Rebind a recycled node object to a new message. Clears the
+  // containers without releasing their capacity, so pooled nodes reuse
+  // their allocations across window turnover. Everything the feeder
+  // needs is extracted into members and the message is released on
+  // return, so a live node never pins its protobuf object or arena
+  void reinit(std::shared_ptr<ChakraProtoMsg::Node> node);
+  // Append the node's extracted fields, dependency ids, and remaining
+  // attributes to the preprocessed-graph cache
+  void writeCacheRecord(std::ostream& out);
+  // Rebind the object from a cache record with no backing protobuf
+  // message. Returns false on a truncated or corrupt record
+  bool reinitFromCache(std::istream& in);
+  // Drop the child references before the object is put on the
+  // freelist, so a pooled node does not pin other nodes. Container
+  // capacity is kept
+  void recycle();
+  bool addChild(std::shared_ptr<ETFeederNode> node);
   std::vector<std::shared_ptr<ETFeederNode>> getChildren();
   void addDepUnresolvedParentID(uint64_t node_id);
   std::vector<uint64_t> getDepUnresolvedParentIDs();
   void setDepUnresolvedParentIDs(
       std::vector<uint64_t> const& dep_unresolved_parent_ids);
+  uint64_t getRemainingDeps();
+  bool releaseDependency();
+  void resetRemainingDeps();
+  // Overwrite the live dependency count; used when the feeder is
+  // rebuilt from a checkpoint
+  void setRemainingDeps(uint64_t remaining_deps);
+  const std::vector<uint64_t>& data_deps();
 
   uint64_t id();
   std::string name();
@@ -35,20 +65,36 @@ class ETFeederNode {
   uint32_t comm_src();
   uint32_t comm_dst();
   uint32_t comm_tag();
+  bool has_other_attr(const std::string& attr_name);
+  ChakraProtoMsg::AttributeProto get_other_attr(const std::string& attr_name);
 
  private:
-  void assign_attr_val(
-      std::shared_ptr<ChakraProtoMsg::Node> node,
-      int i,
-      void* member);
-
-  std::shared_ptr<ChakraProtoMsg::Node> node_{nullptr};
   std::unordered_set<std::shared_ptr<ETFeederNode>> children_set_{};
   std::vector<std::shared_ptr<ETFeederNode>> children_vec_{};
   std::vector<uint64_t> dep_unresolved_parent_ids_{};
+  // Dependency ids copied out of the message (or cache record) so
+  // serialization and linking never need the protobuf object
+  std::vector<uint64_t> data_deps_{};
+
+  // Number of parents that have not retired yet; data_deps itself is
+  // never mutated so a loaded window can be replayed in place
+  std::atomic<uint64_t> num_remaining_deps_{0};
+
+  // Attributes not covered by the dedicated members below, copied out
+  // of the message (or cache record) into owned_attrs_; the map
+  // pointers refer into that vector
+  std::unordered_map<std::string, const ChakraProtoMsg::AttributeProto*>
+      other_attrs_{};
+  std::vector<ChakraProtoMsg::AttributeProto> owned_attrs_{};
+
+  // Dependency count the remaining-deps counter resets to; kept as a
+  // member so cache-loaded nodes do not need the message
+  uint64_t num_total_deps_{0};
 
   uint64_t id_;
-  std::string name_;
+  // Interned name id; the bytes live in the process-wide StringPool
+  uint32_t name_id_;
+  ChakraProtoMsg::NodeType type_;
   uint32_t is_cpu_op_;
   uint64_t runtime_;
   uint64_t num_ops_;
@@ -0,0 +1,134 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "et_def/et_def.pb.h"
+#include "et_feeder/JSONStream.h"
+#include "third_party/utils/protoio.hh"
+
+// Standalone converter: compacts a JSON workload graph into the
+// length-prefixed ChakraProtoMsg .et format so traces are converted
+// once and replayed many times through the fast ETFeeder path.
+// Nodes are streamed through JSONGraphStream and written as they
+// arrive, so memory stays bounded regardless of trace size.
+
+// Translate one streamed JSONNode into a ChakraProtoMsg Node
+static void fillProtoNode(
+    const JSONNode& json_node,
+    ChakraProtoMsg::Node& node) {
+  node.Clear();
+  node.set_id(json_node.node_id);
+  node.set_name(json_node.name());
+  node.set_type(static_cast<ChakraProtoMsg::NodeType>(json_node.node_type));
+  node.set_duration_micros(json_node.runtime);
+  for (int64_t dep : json_node.data_deps) {
+    node.add_data_deps(dep);
+  }
+
+  ChakraProtoMsg::AttributeProto* attr = node.add_attr();
+  attr->set_name("is_cpu_op");
+  attr->set_bool_val(json_node.is_cpu_op);
+
+  if (json_node.num_ops != 0) {
+    attr = node.add_attr();
+    attr->set_name("num_ops");
+    attr->set_int64_val(json_node.num_ops);
+  }
+  if (json_node.tensor_size != 0) {
+    attr = node.add_attr();
+    attr->set_name("tensor_size");
+    attr->set_uint64_val(json_node.tensor_size);
+  }
+
+  // Communication attributes only exist on communication nodes
+  if (json_node.node_type == ChakraProtoMsg::COMM_SEND_NODE ||
+      json_node.node_type == ChakraProtoMsg::COMM_RECV_NODE ||
+      json_node.node_type == ChakraProtoMsg::COMM_COLL_NODE) {
+    attr = node.add_attr();
+    attr->set_name("comm_type");
+    attr->set_int64_val(json_node.comm_type);
+    attr = node.add_attr();
+    attr->set_name("comm_priority");
+    attr->set_int32_val(json_node.comm_priority);
+    attr = node.add_attr();
+    attr->set_name("comm_size");
+    attr->set_uint64_val(json_node.comm_size);
+    attr = node.add_attr();
+    attr->set_name("comm_src");
+    attr->set_int32_val(json_node.comm_src);
+    attr = node.add_attr();
+    attr->set_name("comm_dst");
+    attr->set_int32_val(json_node.comm_dst);
+    attr = node.add_attr();
+    attr->set_name("comm_tag");
+    attr->set_int32_val(json_node.comm_tag);
+    if (json_node.involved_dim.size() != 0) {
+      attr = node.add_attr();
+      attr->set_name("involved_dim");
+      for (bool dim : json_node.involved_dim) {
+        attr->mutable_bool_list()->add_values(dim);
+      }
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <input.json> <output.et>"
+              << std::endl;
+    return 1;
+  }
+  std::string input_filename = argv[1];
+  std::string output_filename = argv[2];
+
+  // Validate the input before touching the output path, so a missing
+  // or unreadable input never clobbers an existing trace
+  {
+    std::ifstream input(input_filename);
+    if (!input.good()) {
+      std::cerr << "Error: Could not open " << input_filename << std::endl;
+      return 1;
+    }
+  }
+
+  // Write to a sidecar and publish with a rename on success, the same
+  // way the feeder publishes its graph cache; a failed conversion
+  // leaves whatever is at the output path untouched
+  const std::string tmp_filename = output_filename + ".tmp";
+  uint64_t num_nodes = 0;
+  {
+    ProtoOutputStream output(tmp_filename);
+
+    ChakraProtoMsg::GlobalMetadata metadata;
+    metadata.set_version("0.0.4");
+    output.write(metadata);
+
+    // Stream nodes straight from the SAX parser to the output; the
+    // buffer bound keeps peak memory independent of the trace size
+    JSONGraphStream stream(input_filename, 4096);
+    JSONNode json_node;
+    ChakraProtoMsg::Node node;
+    while (stream.nextNode(json_node)) {
+      fillProtoNode(json_node, node);
+      output.write(node);
+      ++num_nodes;
+    }
+  }
+
+  if (num_nodes == 0) {
+    std::cerr << "Error: No nodes converted from " << input_filename
+              << std::endl;
+    std::remove(tmp_filename.c_str());
+    return 1;
+  }
+  if (std::rename(tmp_filename.c_str(), output_filename.c_str()) != 0) {
+    std::cerr << "Error: Could not publish " << output_filename << std::endl;
+    std::remove(tmp_filename.c_str());
+    return 1;
+  }
+
+  std::cout << "Converted " << num_nodes << " nodes from " << input_filename
+            << " to " << output_filename << std::endl;
+  return 0;
+}
@@ -0,0 +1,96 @@
+#include "et_feeder/lookahead.h"
+
+#include <stdexcept>
+
+using namespace std;
+using namespace Chakra;
+
+LookaheadScanner::LookaheadScanner(const string& filename, uint64_t capacity)
+    : trace_(filename), capacity_(capacity), ring_(capacity) {
+  if (!trace_.is_open()) {
+    throw runtime_error("Failed to open trace file: " + filename);
+  }
+  ChakraProtoMsg::GlobalMetadata metadata;
+  trace_.read(metadata);
+  cursor_offset_ = trace_.tell();
+}
+
+bool LookaheadScanner::scanOne() {
+  if (eof_ || (count_ == capacity_)) {
+    return false;
+  }
+  if (!trace_.read(msg_)) {
+    eof_ = true;
+    return false;
+  }
+
+  LookaheadRecord& record = ring_[(head_ + count_) % capacity_];
+  record.id = msg_.id();
+  record.type = msg_.type();
+  record.runtime = msg_.duration_micros();
+  record.comm_size = 0;
+  for (const auto& attr : msg_.attr()) {
+    if (attr.name() == "comm_size") {
+      record.comm_size = attr.uint64_val();
+      break;
+    }
+  }
+  record.end_offset = trace_.tell();
+  cursor_offset_ = record.end_offset;
+  ++count_;
+  return true;
+}
+
+void LookaheadScanner::advanceTo(uint64_t offset) {
+  while ((count_ != 0) && (ring_[head_].end_offset <= offset)) {
+    head_ = (head_ + 1) % capacity_;
+    --count_;
+  }
+  // The feeder overtook the cursor (possible after a restore or when
+  // the ring capacity is smaller than the feeder's stride); jump the
+  // cursor forward so peeks stay ahead of the window
+  if (cursor_offset_ < offset) {
+    trace_.seek(offset);
+    cursor_offset_ = offset;
+    eof_ = false;
+  }
+}
+
+uint64_t LookaheadScanner::peek(
+    uint64_t num_records,
+    vector<LookaheadRecord>& out) {
+  out.clear();
+  if (num_records > capacity_) {
+    num_records = capacity_;
+  }
+  while ((count_ < num_records) && scanOne()) {
+  }
+  uint64_t num = (count_ < num_records) ? count_ : num_records;
+  out.reserve(num);
+  for (uint64_t i = 0; i < num; ++i) {
+    out.push_back(at(i));
+  }
+  return num;
+}
+
+LookaheadSummary LookaheadScanner::summarize(uint64_t num_records) {
+  if (num_records > capacity_) {
+    num_records = capacity_;
+  }
+  while ((count_ < num_records) && scanOne()) {
+  }
+  LookaheadSummary summary;
+  uint64_t num = (count_ < num_records) ? count_ : num_records;
+  for (uint64_t i = 0; i < num; ++i) {
+    const LookaheadRecord& record = at(i);
+    ++summary.num_nodes;
+    summary.total_runtime += record.runtime;
+    if ((record.type == ChakraProtoMsg::COMM_SEND_NODE) ||
+        (record.type == ChakraProtoMsg::COMM_RECV_NODE) ||
+        (record.type == ChakraProtoMsg::COMM_COLL_NODE)) {
+      ++summary.num_comm_nodes;
+      summary.total_comm_size += record.comm_size;
+    }
+  }
+  return summary;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "et_def/et_def.pb.h"
+#include "third_party/utils/protoio.hh"
+
+namespace Chakra {
+
+// Compact per-node summary extracted by the lookahead scanner: only
+// the fields forward-planning schedulers ask about, at a fixed few
+// dozen bytes per node instead of a full ETFeederNode
+struct LookaheadRecord {
+  uint64_t id;
+  ChakraProtoMsg::NodeType type;
+  uint64_t runtime;
+  uint64_t comm_size;
+  // Stream offset just past the node's record, used to discard
+  // entries the feeder has already consumed
+  uint64_t end_offset;
+};
+
+// Aggregate over a peeked span, for callers that only want totals
+// (e.g. comm volume arriving in the next few thousand nodes)
+struct LookaheadSummary {
+  uint64_t num_nodes{0};
+  uint64_t num_comm_nodes{0};
+  uint64_t total_comm_size{0};
+  uint64_t total_runtime{0};
+};
+
+// Forward visibility over the trace without growing the feeder's
+// window: a second read cursor on the trace file decodes ahead of the
+// main window into a ring of LookaheadRecords. Messages are parsed
+// into one reused protobuf object and only the summary fields are
+// kept, so peeking thousands of nodes ahead costs kilobytes, not a
+// second copy of the graph.
+//
+// The scanner is single-threaded and independent of the feeder; keep
+// it behind the feeder by calling advanceTo(feeder.consumedOffset())
+// as the simulation progresses
+class LookaheadScanner {
+ public:
+  explicit LookaheadScanner(
+      const std::string& filename,
+      uint64_t capacity = 16384);
+
+  // Drop buffered records the feeder has consumed (end offset at or
+  // before offset) and, if the cursor itself is behind, reseek it to
+  // offset. offset must be a message boundary, e.g. the feeder's
+  // consumedOffset()
+  void advanceTo(uint64_t offset);
+  // Copy up to num_records buffered-or-scanned records past the
+  // current position into out, in trace order; returns the number
+  // copied, short at end of trace. Capped at the ring capacity
+  uint64_t peek(uint64_t num_records, std::vector<LookaheadRecord>& out);
+  // Totals over the next num_records nodes without copying records out
+  LookaheadSummary summarize(uint64_t num_records);
+
+  uint64_t capacity() const {
+    return capacity_;
+  }
+
+ private:
+  // Decode one node into the ring; returns false at end of trace or
+  // when the ring is full
+  bool scanOne();
+  const LookaheadRecord& at(uint64_t i) const {
+    return ring_[(head_ + i) % capacity_];
+  }
+
+  ProtoInputStream trace_;
+  const uint64_t capacity_;
+  std::vector<LookaheadRecord> ring_;
+  uint64_t head_{0};
+  uint64_t count_{0};
+  // Offset just past the last node the cursor scanned
+  uint64_t cursor_offset_{0};
+  bool eof_{false};
+  // Reused across nodes; the scanner never allocates per record
+  ChakraProtoMsg::Node msg_;
+};
+
+} // namespace Chakra
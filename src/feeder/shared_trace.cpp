@@ -0,0 +1,188 @@
+#include "et_feeder/shared_trace.h"
+
+#include <stdexcept>
+
+#include "third_party/utils/protoio.hh"
+
+using namespace std;
+using namespace Chakra;
+
+shared_ptr<SharedTraceStore> SharedTraceStore::open(const string& filename) {
+  // Process-wide registry of live stores; a weak reference so a store
+  // is decoded at most once while any rank holds it and reclaimed once
+  // the sweep tears down
+  static mutex registry_mutex;
+  static unordered_map<string, weak_ptr<SharedTraceStore>> registry;
+
+  lock_guard<mutex> lock(registry_mutex);
+  auto it = registry.find(filename);
+  if (it != registry.end()) {
+    shared_ptr<SharedTraceStore> store = it->second.lock();
+    if (store != nullptr) {
+      return store;
+    }
+  }
+  shared_ptr<SharedTraceStore> store(new SharedTraceStore(filename));
+  registry[filename] = store;
+  return store;
+}
+
+SharedTraceStore::SharedTraceStore(const string& filename) {
+  ProtoInputStream trace(filename);
+  if (!trace.is_open()) {
+    throw runtime_error("Failed to open trace file: " + filename);
+  }
+  ChakraProtoMsg::GlobalMetadata metadata;
+  trace.read(metadata);
+
+  // Decode every node; the extracted form releases each message as
+  // soon as its fields are copied out
+  shared_ptr<ChakraProtoMsg::Node> pkt_msg =
+      make_shared<ChakraProtoMsg::Node>();
+  while (trace.read(*pkt_msg)) {
+    shared_ptr<ETFeederNode> node = make_shared<ETFeederNode>(pkt_msg);
+    pos_by_id_[node->id()] = nodes_.size();
+    nodes_.push_back(move(node));
+    pkt_msg->Clear();
+  }
+
+  // Link the child topology once; every rank shares these edges. A
+  // dependency on an id the trace never defines counts as already
+  // satisfied
+  children_pos_.resize(nodes_.size());
+  initial_deps_.assign(nodes_.size(), 0);
+  for (uint64_t pos = 0; pos < nodes_.size(); ++pos) {
+    for (uint64_t dep_id : nodes_[pos]->data_deps()) {
+      auto parent = pos_by_id_.find(dep_id);
+      if (parent == pos_by_id_.end()) {
+        continue;
+      }
+      children_pos_[parent->second].push_back(pos);
+      nodes_[parent->second]->addChild(nodes_[pos]);
+      ++initial_deps_[pos];
+    }
+  }
+}
+
+bool SharedTraceStore::positionOf(uint64_t node_id, uint64_t& pos) const {
+  auto it = pos_by_id_.find(node_id);
+  if (it == pos_by_id_.end()) {
+    return false;
+  }
+  pos = it->second;
+  return true;
+}
+
+SharedTraceFeeder::SharedTraceFeeder(shared_ptr<SharedTraceStore> store)
+    : store_(move(store)),
+      remaining_deps_(new atomic<uint64_t>[store_->numNodes()]) {
+  uint64_t num_nodes = store_->numNodes();
+  live_nodes_ = num_nodes;
+  for (uint64_t pos = 0; pos < num_nodes; ++pos) {
+    remaining_deps_[pos] = store_->initialDeps(pos);
+    if (store_->initialDeps(pos) == 0) {
+      pushDepFree(pos);
+    }
+  }
+}
+
+DepFreeShard& SharedTraceFeeder::shardFor(uint64_t node_id) {
+  return dep_free_shards_[node_id % num_shards_];
+}
+
+void SharedTraceFeeder::pushDepFree(uint64_t pos) {
+  shared_ptr<ETFeederNode> node = store_->nodeAt(pos);
+  uint64_t node_id = node->id();
+  DepFreeShard& shard = shardFor(node_id);
+  lock_guard<mutex> lock(shard.mutex);
+  // The occupancy bitmap rejects duplicates, so racing pushers cannot
+  // enqueue the same node twice
+  shard.queue.insert(node_id / num_shards_, move(node));
+}
+
+bool SharedTraceFeeder::hasNodesToIssue() {
+  return live_nodes_.load() != 0;
+}
+
+shared_ptr<ETFeederNode> SharedTraceFeeder::getNextIssuableNode() {
+  // Find the lowest-id dep-free node across the shards, then pop it
+  // from its shard; retry if a concurrent pop won the race
+  while (true) {
+    bool found = false;
+    uint64_t best_id = 0;
+    uint32_t best_shard = 0;
+    for (uint32_t i = 0; i < num_shards_; ++i) {
+      lock_guard<mutex> lock(dep_free_shards_[i].mutex);
+      if (!dep_free_shards_[i].queue.empty()) {
+        uint64_t top_id = dep_free_shards_[i].queue.top()->id();
+        if (!found || (top_id < best_id)) {
+          found = true;
+          best_id = top_id;
+          best_shard = i;
+        }
+      }
+    }
+    if (!found) {
+      return nullptr;
+    }
+
+    DepFreeShard& shard = dep_free_shards_[best_shard];
+    lock_guard<mutex> lock(shard.mutex);
+    if (!shard.queue.empty() && (shard.queue.top()->id() == best_id)) {
+      return shard.queue.popMin();
+    }
+  }
+}
+
+void SharedTraceFeeder::pushBackIssuableNode(uint64_t node_id) {
+  uint64_t pos = 0;
+  if (store_->positionOf(node_id, pos)) {
+    pushDepFree(pos);
+  }
+}
+
+shared_ptr<ETFeederNode> SharedTraceFeeder::lookupNode(uint64_t node_id) {
+  uint64_t pos = 0;
+  if (!store_->positionOf(node_id, pos)) {
+    throw runtime_error(
+        "looking for node_id=" + to_string(node_id) +
+        " in the shared trace store, however, not present");
+  }
+  return store_->nodeAt(pos);
+}
+
+void SharedTraceFeeder::freeChildrenNodes(uint64_t node_id) {
+  uint64_t pos = 0;
+  if (!store_->positionOf(node_id, pos)) {
+    return;
+  }
+  for (uint64_t child_pos : store_->childrenAt(pos)) {
+    // Same guarded decrement as ETFeederNode::releaseDependency, but
+    // against this rank's counter
+    atomic<uint64_t>& remaining = remaining_deps_[child_pos];
+    uint64_t cur = remaining.load();
+    while (cur != 0) {
+      if (remaining.compare_exchange_weak(cur, cur - 1)) {
+        if (cur == 1) {
+          pushDepFree(child_pos);
+        }
+        break;
+      }
+    }
+  }
+}
+
+void SharedTraceFeeder::removeNode(uint64_t node_id) {
+  uint64_t pos = 0;
+  if (!store_->positionOf(node_id, pos)) {
+    return;
+  }
+  // The shared node itself stays for the other ranks; retirement only
+  // updates this rank's progress
+  uint64_t live = live_nodes_.load();
+  while (live != 0) {
+    if (live_nodes_.compare_exchange_weak(live, live - 1)) {
+      break;
+    }
+  }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "et_feeder/et_feeder.h"
+#include "et_feeder/et_feeder_node.h"
+
+namespace Chakra {
+
+// One immutable decoded copy of a trace, shared by every replicated
+// rank in the process. Data-parallel sweeps replay byte-identical
+// traces on hundreds of ranks; decoding the trace once and sharing the
+// node objects and child topology turns that into a single decode and
+// a single resident graph, with only per-rank progress state
+// replicated (see SharedTraceFeeder).
+//
+// The store decodes the whole trace up front, so unlike ETFeeder it
+// trades windowed memory for cross-rank sharing; at one copy per
+// process that is the cheaper side of the trade for replicated ranks.
+// Everything in the store, including the node objects handed out at
+// issue time, is immutable after construction.
+class SharedTraceStore {
+ public:
+  // Returns the process-wide store for filename, decoding the trace on
+  // the first open; later opens share the same instance. The store is
+  // dropped once the last rank releases it
+  static std::shared_ptr<SharedTraceStore> open(const std::string& filename);
+
+  uint64_t numNodes() const {
+    return nodes_.size();
+  }
+  std::shared_ptr<ETFeederNode> nodeAt(uint64_t pos) const {
+    return nodes_[pos];
+  }
+  // Position lookup by node id; returns false for unknown ids
+  bool positionOf(uint64_t node_id, uint64_t& pos) const;
+  // Children as store positions, for counter updates without an id
+  // hash lookup per edge
+  const std::vector<uint64_t>& childrenAt(uint64_t pos) const {
+    return children_pos_[pos];
+  }
+  // Number of dependencies the trace declares for the node; the
+  // starting value of every rank's remaining-deps counter
+  uint64_t initialDeps(uint64_t pos) const {
+    return initial_deps_[pos];
+  }
+
+ private:
+  explicit SharedTraceStore(const std::string& filename);
+
+  std::vector<std::shared_ptr<ETFeederNode>> nodes_{};
+  std::unordered_map<uint64_t, uint64_t> pos_by_id_{};
+  std::vector<std::vector<uint64_t>> children_pos_{};
+  std::vector<uint64_t> initial_deps_{};
+};
+
+// Per-rank overlay over a SharedTraceStore: the rank's remaining-deps
+// counters and its dep-free queues, which are the only parts of the
+// feeder state that differ between replicated ranks. Mirrors the
+// ETFeeder issue/retire surface so a simulator rank can drive either.
+//
+// The issued node objects are the store's shared immutable nodes; all
+// progress lives in the overlay, so one rank's retirement never
+// touches another rank's view.
+class SharedTraceFeeder {
+ public:
+  explicit SharedTraceFeeder(std::shared_ptr<SharedTraceStore> store);
+
+  bool hasNodesToIssue();
+  std::shared_ptr<ETFeederNode> getNextIssuableNode();
+  void pushBackIssuableNode(uint64_t node_id);
+  std::shared_ptr<ETFeederNode> lookupNode(uint64_t node_id);
+  void freeChildrenNodes(uint64_t node_id);
+  void removeNode(uint64_t node_id);
+
+ private:
+  // Same sharding as ETFeeder so worker threads of one rank do not
+  // funnel through a global mutex
+  static const uint32_t num_shards_ = 16;
+
+  DepFreeShard& shardFor(uint64_t node_id);
+  void pushDepFree(uint64_t pos);
+
+  std::shared_ptr<SharedTraceStore> store_;
+  // Rank-private remaining-deps counter per store position
+  std::unique_ptr<std::atomic<uint64_t>[]> remaining_deps_;
+  std::array<DepFreeShard, num_shards_> dep_free_shards_{};
+  // Nodes this rank has not retired yet
+  std::atomic<uint64_t> live_nodes_{0};
+};
+
+} // namespace Chakra
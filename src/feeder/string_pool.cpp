@@ -0,0 +1,43 @@
+#include <mutex>
+
+#include "et_feeder/string_pool.h"
+
+using namespace std;
+using namespace Chakra;
+
+StringPool& StringPool::instance() {
+  static StringPool pool;
+  return pool;
+}
+
+uint32_t StringPool::intern(const string& str) {
+  {
+    shared_lock<shared_mutex> lock(mutex_);
+    auto it = ids_.find(str);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+  }
+
+  unique_lock<shared_mutex> lock(mutex_);
+  // Re-check under the exclusive lock; another thread may have
+  // interned the same name in between
+  auto it = ids_.find(str);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+  uint32_t id = static_cast<uint32_t>(strings_.size());
+  strings_.emplace_back(str);
+  ids_.emplace(str, id);
+  return id;
+}
+
+const string& StringPool::resolve(uint32_t id) const {
+  shared_lock<shared_mutex> lock(mutex_);
+  return strings_[id];
+}
+
+uint64_t StringPool::size() const {
+  shared_lock<shared_mutex> lock(mutex_);
+  return strings_.size();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Chakra {
+
+// Process-wide interning pool for node names. Traces repeat a few
+// hundred distinct operator names across millions of nodes, so nodes
+// store a 32-bit id into the pool instead of a full string copy.
+// Interned strings live for the lifetime of the process
+class StringPool {
+ public:
+  static StringPool& instance();
+  uint32_t intern(const std::string& str);
+  const std::string& resolve(uint32_t id) const;
+  uint64_t size() const;
+
+ private:
+  StringPool() = default;
+
+  // Lookups take the lock shared; only a first-seen name takes it
+  // exclusive. The deque keeps resolved references stable across
+  // growth
+  mutable std::shared_mutex mutex_;
+  std::deque<std::string> strings_{};
+  std::unordered_map<std::string, uint32_t> ids_{};
+};
+
+} // namespace Chakra
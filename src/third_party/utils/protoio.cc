@@ -37,38 +37,60 @@
 
 #include "protoio.hh"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <climits>
+
 #define panic(format, args...)
 
 using namespace google::protobuf;
 
+uint64_t ProtoInputStream::mmapWindowLimit = INT_MAX;
+
 ProtoOutputStream::ProtoOutputStream(const std::string& filename)
     : fileStream(
           filename.c_str(),
           std::ios::out | std::ios::binary | std::ios::trunc),
       wrappedFileStream(NULL),
       gzipStream(NULL),
+      zstdStream(NULL),
       zeroCopyStream(NULL) {
   if (!fileStream.good())
     panic("Could not open %s for writing\n", filename);
 
   // Wrap the output file in a zero copy stream, that in turn is
-  // wrapped in a gzip stream if the filename ends with .gz. The
-  // latter stream is in turn wrapped in a coded stream
-  wrappedFileStream = new io::OstreamOutputStream(&fileStream);
-  if (filename.find_last_of('.') != std::string::npos &&
-      filename.substr(filename.find_last_of('.') + 1) == "gz") {
-    gzipStream = new io::GzipOutputStream(wrappedFileStream);
-    zeroCopyStream = gzipStream;
+  // wrapped in a gzip or zstd stream if the filename ends with .gz or
+  // .zst. The latter stream is in turn wrapped in a coded stream
+  std::string extension;
+  if (filename.find_last_of('.') != std::string::npos)
+    extension = filename.substr(filename.find_last_of('.') + 1);
+  if (extension == "zst") {
+    // The zstd stream compresses independent frames straight into the
+    // file, so a reader can decompress them in parallel
+    zstdStream = new ZstdOstreamOutputStream(fileStream);
+    zeroCopyStream = zstdStream;
   } else {
-    zeroCopyStream = wrappedFileStream;
+    wrappedFileStream = new io::OstreamOutputStream(&fileStream);
+    if (extension == "gz") {
+      gzipStream = new io::GzipOutputStream(wrappedFileStream);
+      zeroCopyStream = gzipStream;
+    } else {
+      zeroCopyStream = wrappedFileStream;
+    }
   }
 }
 
 ProtoOutputStream::~ProtoOutputStream() {
-  // As the compression is optional, see if the stream exists
+  // As the compression is optional, see if the streams exist
   if (gzipStream != NULL)
     delete gzipStream;
-  delete wrappedFileStream;
+  if (zstdStream != NULL)
+    delete zstdStream;
+  if (wrappedFileStream != NULL)
+    delete wrappedFileStream;
   fileStream.close();
 }
 
@@ -94,56 +116,137 @@ ProtoInputStream::ProtoInputStream(const std::string& filename)
     : fileStream(filename.c_str(), std::ios::in | std::ios::binary),
       fileName(filename),
       useGzip(false),
+      useZstd(false),
+      useMmap(false),
+      streamPos(0),
+      mmapBase(NULL),
+      mmapSize(0),
+      mmapWindowEnd(0),
+      mmapStream(NULL),
       wrappedFileStream(NULL),
       gzipStream(NULL),
+      zstdStream(NULL),
       zeroCopyStream(NULL) {
   if (!fileStream.good())
     panic("Could not open %s for reading\n", filename);
 
-  // check the magic number to see if this is a gzip stream
-  unsigned char bytes[2];
-  fileStream.read((char*)bytes, 2);
+  // check the magic number to see if this is a gzip or zstd stream
+  unsigned char bytes[4];
+  fileStream.read((char*)bytes, 4);
   useGzip = fileStream.good() && bytes[0] == 0x1f && bytes[1] == 0x8b;
+  useZstd = fileStream.good() && bytes[0] == 0x28 && bytes[1] == 0xb5 &&
+      bytes[2] == 0x2f && bytes[3] == 0xfd;
 
   // seek to the start of the input file and clear any flags
   fileStream.clear();
   fileStream.seekg(0, std::ifstream::beg);
 
+  // For an uncompressed file, map it read-only so parsing happens
+  // straight out of the page cache with no copy through stdio, and so
+  // concurrent readers of the same trace share one set of pages
+  if (!useGzip && !useZstd) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      struct stat file_stat;
+      if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        void* base =
+            mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (base != MAP_FAILED) {
+          mmapBase = base;
+          mmapSize = file_stat.st_size;
+          useMmap = true;
+        }
+      }
+      close(fd);
+    }
+  }
+
   createStreams();
 }
 
 void ProtoInputStream::createStreams() {
   // All streams should be NULL at this point
   assert(
-      wrappedFileStream == NULL && gzipStream == NULL &&
-      zeroCopyStream == NULL);
-
-  // Wrap the input file in a zero copy stream, that in turn is
-  // wrapped in a gzip stream if the filename ends with .gz. The
-  // latter stream is in turn wrapped in a coded stream
-  wrappedFileStream = new io::IstreamInputStream(&fileStream);
-  if (useGzip) {
-    gzipStream = new io::GzipInputStream(wrappedFileStream);
-    zeroCopyStream = gzipStream;
+      mmapStream == NULL && wrappedFileStream == NULL && gzipStream == NULL &&
+      zstdStream == NULL && zeroCopyStream == NULL);
+
+  // A memory-mapped file is exposed directly as an array, positioned
+  // at the current stream offset. A zstd file is handed to the
+  // parallel frame decompressor. Otherwise wrap the input file in a
+  // zero copy stream, that in turn is wrapped in a gzip stream if the
+  // filename ends with .gz. The latter stream is in turn wrapped in a
+  // coded stream
+  if (useMmap) {
+    // The array stream size is an int, so a mapping larger than
+    // mmapWindowLimit (INT_MAX) is exposed through a partial window;
+    // reads that stop at its end slide it forward via remapWindow
+    uint64_t window = mmapSize - streamPos;
+    if (window > mmapWindowLimit)
+      window = mmapWindowLimit;
+    mmapStream =
+        new io::ArrayInputStream((const char*)mmapBase + streamPos, window);
+    mmapWindowEnd = streamPos + window;
+    zeroCopyStream = mmapStream;
+  } else if (useZstd) {
+    zstdStream = new ZstdInputStream(fileName);
+    zeroCopyStream = zstdStream;
   } else {
-    zeroCopyStream = wrappedFileStream;
+    wrappedFileStream = new io::IstreamInputStream(&fileStream);
+    if (useGzip) {
+      gzipStream = new io::GzipInputStream(wrappedFileStream);
+      zeroCopyStream = gzipStream;
+    } else {
+      zeroCopyStream = wrappedFileStream;
+    }
   }
 }
 
 void ProtoInputStream::destroyStreams() {
-  // As the compression is optional, see if the stream exists
+  // As the compression and memory mapping are optional, see if the
+  // streams exist
   if (gzipStream != NULL) {
     delete gzipStream;
     gzipStream = NULL;
   }
-  delete wrappedFileStream;
-  wrappedFileStream = NULL;
+  if (zstdStream != NULL) {
+    delete zstdStream;
+    zstdStream = NULL;
+  }
+  if (mmapStream != NULL) {
+    delete mmapStream;
+    mmapStream = NULL;
+  }
+  if (wrappedFileStream != NULL) {
+    delete wrappedFileStream;
+    wrappedFileStream = NULL;
+  }
 
   zeroCopyStream = NULL;
 }
 
+bool ProtoInputStream::remapWindow() {
+  if (!useMmap)
+    return false;
+
+  // Recreating the window at the current offset only helps if it can
+  // cover more of the file than the one the read just failed against;
+  // otherwise the failure is a real end of stream or a corrupt record
+  uint64_t window = mmapSize - streamPos;
+  if (window > mmapWindowLimit)
+    window = mmapWindowLimit;
+  if (streamPos + window == mmapWindowEnd)
+    return false;
+
+  destroyStreams();
+  createStreams();
+  return true;
+}
+
 ProtoInputStream::~ProtoInputStream() {
   destroyStreams();
+  if (useMmap) {
+    munmap(mmapBase, mmapSize);
+  }
   fileStream.close();
 }
 
@@ -152,33 +255,122 @@ void ProtoInputStream::reset() {
   // seek to the start of the input file and clear any flags
   fileStream.clear();
   fileStream.seekg(0, std::ifstream::beg);
+  streamPos = 0;
   createStreams();
 }
 
+uint64_t ProtoInputStream::tell() const {
+  return streamPos;
+}
+
+bool ProtoInputStream::seek(uint64_t offset) {
+  if (useMmap) {
+    // The mapping covers the whole file, so seeking is just
+    // recreating the array stream at the requested offset. Validate
+    // the offset before tearing anything down; panic is a no-op here,
+    // so returning with the streams destroyed would leave the next
+    // read dereferencing a null stream
+    if (offset > mmapSize) {
+      panic("Unable to seek to offset %llu in %s\n", offset, fileName);
+      return false;
+    }
+    destroyStreams();
+    streamPos = offset;
+    createStreams();
+    return true;
+  }
+  destroyStreams();
+  fileStream.clear();
+  if (useGzip || useZstd) {
+    // A compressed stream cannot be positioned directly, so rewind
+    // the file and skip decompressed bytes until the offset is
+    // reached
+    fileStream.seekg(0, std::ifstream::beg);
+    createStreams();
+    uint64_t remaining = offset;
+    while (remaining > 0) {
+      int chunk = remaining > INT_MAX ? INT_MAX : (int)remaining;
+      if (!zeroCopyStream->Skip(chunk)) {
+        panic("Unable to seek to offset %llu in %s\n", offset, fileName);
+        return false;
+      }
+      remaining -= chunk;
+    }
+  } else {
+    fileStream.seekg(offset, std::ifstream::beg);
+    createStreams();
+    if (!fileStream.good()) {
+      panic("Unable to seek to offset %llu in %s\n", offset, fileName);
+      return false;
+    }
+  }
+  streamPos = offset;
+  return true;
+}
+
 bool ProtoInputStream::is_open() {
   return fileStream.is_open();
 }
 
 bool ProtoInputStream::read(Message& msg) {
   // Read a message from the stream by getting the size, using it as
-  // a limit when parsing the message, then popping the limit again
+  // a limit when parsing the message, then popping the limit again.
+  // A read that stops at the end of a partial mmap window is retried
+  // against a slid window; streamPos still marks the message boundary
   uint32_t size;
 
-  // Due to the byte limit of the coded stream we create it for
-  // every single mesage (based on forum discussions around the size
-  // limitation)
-  io::CodedInputStream codedStream(zeroCopyStream);
-  if (codedStream.ReadVarint32(&size)) {
-    io::CodedInputStream::Limit limit = codedStream.PushLimit(size);
-    if (msg.ParseFromCodedStream(&codedStream)) {
-      codedStream.PopLimit(limit);
-      // All went well, the message is parsed and the limit is
-      // popped again
-      return true;
-    } else {
-      panic("Unable to read message from coded stream %s\n", fileName);
+  for (;;) {
+    bool got_size = false;
+    {
+      // Due to the byte limit of the coded stream we create it for
+      // every single mesage (based on forum discussions around the size
+      // limitation)
+      io::CodedInputStream codedStream(zeroCopyStream);
+      if (codedStream.ReadVarint32(&size)) {
+        got_size = true;
+        io::CodedInputStream::Limit limit = codedStream.PushLimit(size);
+        if (msg.ParseFromCodedStream(&codedStream)) {
+          codedStream.PopLimit(limit);
+          // All went well, the message is parsed and the limit is
+          // popped again; account for the varint and the message body
+          streamPos += codedStream.CurrentPosition();
+          return true;
+        }
+      }
+    }
+
+    if (!remapWindow()) {
+      if (got_size)
+        panic("Unable to read message from coded stream %s\n", fileName);
+      return false;
     }
   }
+}
 
-  return false;
+bool ProtoInputStream::readRecord(std::string& record) {
+  // Pull the size prefix and the raw message bytes off the stream
+  // without touching a message object; the caller parses elsewhere.
+  // Retried against a slid window like read() above
+  uint32_t size;
+
+  for (;;) {
+    bool got_size = false;
+    {
+      io::CodedInputStream codedStream(zeroCopyStream);
+      if (codedStream.ReadVarint32(&size)) {
+        got_size = true;
+        if (codedStream.ReadString(&record, size)) {
+          // Account for the varint and the record body
+          streamPos += codedStream.CurrentPosition();
+          return true;
+        }
+      }
+    }
+
+    if (!remapWindow()) {
+      if (got_size)
+        panic("Unable to read record from coded stream %s\n", fileName);
+      return false;
+    }
+  }
 }
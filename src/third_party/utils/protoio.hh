@@ -50,6 +50,8 @@
 
 #include <fstream>
 
+#include "zstdstream.hh"
+
 /**
  * A ProtoStream provides the shared functionality of the input and
  * output streams. At the moment this is limited to magic number.
@@ -86,7 +88,8 @@ class ProtoOutputStream : public ProtoStream {
  public:
   /**
    * Create an output stream for a given file name. If the filename
-   * ends with .gz then the file will be compressed accordinly.
+   * ends with .gz or .zst then the file will be compressed
+   * accordinly.
    *
    * @param filename Path to the file to create or truncate
    */
@@ -116,6 +119,9 @@ class ProtoOutputStream : public ProtoStream {
   /// Optional Gzip stream to wrap the Zero Copy stream
   google::protobuf::io::GzipOutputStream* gzipStream;
 
+  /// Optional multi-frame Zstandard stream writing to the file
+  ZstdOstreamOutputStream* zstdStream;
+
   /// Top-level zero-copy stream, either with compression or not
   google::protobuf::io::ZeroCopyOutputStream* zeroCopyStream;
 };
@@ -131,7 +137,8 @@ class ProtoInputStream : public ProtoStream {
  public:
   /**
    * Create an input stream for a given file name. If the filename
-   * ends with .gz then the file will be decompressed accordingly.
+   * ends with .gz or .zst then the file will be decompressed
+   * accordingly.
    *
    * @param filename Path to the file to read from
    */
@@ -153,17 +160,58 @@ class ProtoInputStream : public ProtoStream {
    */
   bool read(google::protobuf::Message& msg);
 
+  /**
+   * Read the raw bytes of one length-prefixed record from the stream
+   * without parsing it, so decoding can happen on another thread.
+   *
+   * @param record Serialized message bytes read from the stream
+   * @param return True if a record was read, false if reading fails
+   */
+  bool readRecord(std::string& record);
+
   /**
    * Reset the input stream and seek to the beginning of the file.
    */
   void reset();
 
+  /**
+   * Get the offset of the next message in the stream. For a
+   * compressed stream the offset is in the decompressed byte stream.
+   *
+   * @param return Offset in bytes of the next message to be read
+   */
+  uint64_t tell() const;
+
+  /**
+   * Seek to a message boundary previously obtained through tell().
+   * For a compressed stream the stream is rewound and decompressed up
+   * to the requested offset, as gzip offers no random access.
+   *
+   * @param offset Offset in bytes to position the stream at
+   * @param return True if the stream was positioned at the offset
+   */
+  bool seek(uint64_t offset);
+
+  /// Largest span of the memory mapping exposed through one array
+  /// stream, whose constructor takes an int; reads that hit the end of
+  /// a partial window slide it forward. Tests lower this to exercise
+  /// the sliding on small files
+  static uint64_t mmapWindowLimit;
+
  private:
   /**
    * Create the internal streams that are wrapping the input file.
    */
   void createStreams();
 
+  /**
+   * Slide the memory-map window forward to the current offset after a
+   * read stopped at the end of a partial window.
+   *
+   * @param return True if the window moved and the read can be retried
+   */
+  bool remapWindow();
+
   /**
    * Destroy the internal streams that are wrapping the input file.
    */
@@ -178,12 +226,36 @@ class ProtoInputStream : public ProtoStream {
   /// Boolean flag to remember whether we use gzip or not
   bool useGzip;
 
+  /// Boolean flag to remember whether we use zstd or not
+  bool useZstd;
+
+  /// Boolean flag to remember whether the file is memory mapped
+  bool useMmap;
+
+  /// Offset in bytes of the next message in the (decompressed) stream
+  uint64_t streamPos;
+
+  /// Base address of the memory mapping, if any
+  void* mmapBase;
+
+  /// Size in bytes of the memory mapping, if any
+  uint64_t mmapSize;
+
+  /// Offset in bytes just past the current memory-map window
+  uint64_t mmapWindowEnd;
+
+  /// Zero Copy stream reading straight out of the memory mapping
+  google::protobuf::io::ArrayInputStream* mmapStream;
+
   /// Zero Copy stream wrapping the STL input stream
   google::protobuf::io::IstreamInputStream* wrappedFileStream;
 
   /// Optional Gzip stream to wrap the Zero Copy stream
   google::protobuf::io::GzipInputStream* gzipStream;
 
+  /// Optional parallel Zstandard decompression stream
+  ZstdInputStream* zstdStream;
+
   /// Top-level zero-copy stream, either with compression or not
   google::protobuf::io::ZeroCopyInputStream* zeroCopyStream;
 };
@@ -0,0 +1,218 @@
+#include "zstdstream.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+ZstdOstreamOutputStream::ZstdOstreamOutputStream(
+    std::ostream& os, size_t frame_size)
+    : os(os), buffer(frame_size), bufferPos(0), totalBytes(0) {}
+
+ZstdOstreamOutputStream::~ZstdOstreamOutputStream() {
+  flushFrame();
+}
+
+bool ZstdOstreamOutputStream::Next(void** data, int* size) {
+  // Hand out the rest of the staging buffer, compressing it as one
+  // frame first if it is already full
+  if (bufferPos == buffer.size())
+    flushFrame();
+
+  *data = buffer.data() + bufferPos;
+  *size = buffer.size() - bufferPos;
+  totalBytes += *size;
+  bufferPos = buffer.size();
+  return os.good();
+}
+
+void ZstdOstreamOutputStream::BackUp(int count) {
+  bufferPos -= count;
+  totalBytes -= count;
+}
+
+int64_t ZstdOstreamOutputStream::ByteCount() const {
+  return totalBytes;
+}
+
+void ZstdOstreamOutputStream::flushFrame() {
+  if (bufferPos == 0)
+    return;
+
+  compressed.resize(ZSTD_compressBound(bufferPos));
+  size_t compressed_size = ZSTD_compress(
+      compressed.data(),
+      compressed.size(),
+      buffer.data(),
+      bufferPos,
+      ZSTD_CLEVEL_DEFAULT);
+  if (ZSTD_isError(compressed_size)) {
+    // Skipping the frame would leave a structurally valid multi-frame
+    // file with a silent hole in the middle, which a reader only sees
+    // as an early EOF; fail the underlying stream instead so the
+    // writer notices (Next() reports os.good() to its caller)
+    os.setstate(std::ios::failbit);
+  } else {
+    os.write(compressed.data(), compressed_size);
+  }
+  bufferPos = 0;
+}
+
+ZstdInputStream::ZstdInputStream(
+    const std::string& filename, uint32_t num_threads)
+    : mapBase(NULL),
+      mapSize(0),
+      nextFrame(0),
+      stop(false),
+      currentPos(0),
+      consumeIndex(0),
+      totalBytes(0) {
+  // Map the compressed file read-only; the frame splitter and the
+  // workers all read straight out of the page cache
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    void* base = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base != MAP_FAILED) {
+      mapBase = base;
+      mapSize = file_stat.st_size;
+    }
+  }
+  close(fd);
+  if (mapBase == NULL)
+    return;
+
+  // Split the file on frame boundaries; every frame is independently
+  // decompressible so this is just a walk over the frame headers
+  size_t offset = 0;
+  while (offset < mapSize) {
+    size_t frame_size = ZSTD_findFrameCompressedSize(
+        (const char*)mapBase + offset, mapSize - offset);
+    if (ZSTD_isError(frame_size) || frame_size == 0) {
+      frames.clear();
+      munmap(mapBase, mapSize);
+      mapBase = NULL;
+      return;
+    }
+    frames.emplace_back(offset, frame_size);
+    offset += frame_size;
+  }
+
+  // Let the workers run a bounded number of frames ahead of the
+  // consumer so memory stays bounded but every worker can make
+  // progress
+  maxAhead = num_threads * 2 + 2;
+  for (uint32_t i = 0; i < num_threads; ++i)
+    workers.emplace_back(&ZstdInputStream::workerLoop, this);
+}
+
+ZstdInputStream::~ZstdInputStream() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  aheadCv.notify_all();
+  for (auto& worker : workers)
+    worker.join();
+  if (mapBase != NULL)
+    munmap(mapBase, mapSize);
+}
+
+bool ZstdInputStream::isOpen() const {
+  return mapBase != NULL;
+}
+
+void ZstdInputStream::workerLoop() {
+  while (true) {
+    size_t index = nextFrame.fetch_add(1);
+    if (index >= frames.size())
+      return;
+
+    {
+      // Do not run too far ahead of the consumer
+      std::unique_lock<std::mutex> lock(mutex);
+      aheadCv.wait(lock, [this, index] {
+        return stop || index < consumeIndex + maxAhead;
+      });
+      if (stop)
+        return;
+    }
+
+    const char* src = (const char*)mapBase + frames[index].first;
+    size_t src_size = frames[index].second;
+    unsigned long long content_size = ZSTD_getFrameContentSize(src, src_size);
+    std::string frame;
+    if (content_size != ZSTD_CONTENTSIZE_ERROR &&
+        content_size != ZSTD_CONTENTSIZE_UNKNOWN) {
+      frame.resize(content_size);
+      size_t decompressed = ZSTD_decompress(
+          &frame[0], frame.size(), src, src_size);
+      if (ZSTD_isError(decompressed))
+        frame.clear();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      readyFrames[index] = std::move(frame);
+    }
+    readyCv.notify_all();
+  }
+}
+
+bool ZstdInputStream::Next(const void** data, int* size) {
+  // Serve the rest of the current frame, or block until the workers
+  // deliver the next one in order
+  while (currentPos == currentFrame.size()) {
+    if (consumeIndex >= frames.size())
+      return false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    readyCv.wait(lock, [this] {
+      return readyFrames.find(consumeIndex) != readyFrames.end();
+    });
+    currentFrame = std::move(readyFrames[consumeIndex]);
+    readyFrames.erase(consumeIndex);
+    ++consumeIndex;
+    currentPos = 0;
+    lock.unlock();
+    aheadCv.notify_all();
+
+    // An empty frame here means a decompression error; give up rather
+    // than serving a hole in the stream
+    if (currentFrame.empty())
+      return false;
+  }
+
+  *data = currentFrame.data() + currentPos;
+  *size = currentFrame.size() - currentPos;
+  totalBytes += *size;
+  currentPos = currentFrame.size();
+  return true;
+}
+
+void ZstdInputStream::BackUp(int count) {
+  currentPos -= count;
+  totalBytes -= count;
+}
+
+bool ZstdInputStream::Skip(int count) {
+  while (count > 0) {
+    const void* data;
+    int size;
+    if (!Next(&data, &size))
+      return false;
+    if (size > count) {
+      BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+  return true;
+}
+
+int64_t ZstdInputStream::ByteCount() const {
+  return totalBytes;
+}
@@ -0,0 +1,129 @@
+#ifndef __PROTO_ZSTDSTREAM_HH__
+#define __PROTO_ZSTDSTREAM_HH__
+
+#include <google/protobuf/io/zero_copy_stream.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * A ZstdOstreamOutputStream is a zero-copy output stream that
+ * compresses with Zstandard into independent frames of a fixed
+ * uncompressed size. Because every frame can be decompressed on its
+ * own, a reader is free to decode several frames in parallel, unlike
+ * the single gzip stream the existing path produces.
+ */
+class ZstdOstreamOutputStream
+    : public google::protobuf::io::ZeroCopyOutputStream {
+ public:
+  /**
+   * Create a compressing output stream on top of an already opened
+   * binary output stream.
+   *
+   * @param os Stream to write the compressed frames to
+   * @param frame_size Uncompressed bytes per independent frame
+   */
+  ZstdOstreamOutputStream(std::ostream& os, size_t frame_size = 1 << 20);
+
+  /**
+   * Flush the remaining partial frame and finish the stream.
+   */
+  ~ZstdOstreamOutputStream();
+
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  /// Compress the buffered bytes as one independent frame
+  void flushFrame();
+
+  /// Underlying output stream for the compressed frames
+  std::ostream& os;
+
+  /// Staging buffer holding one uncompressed frame
+  std::vector<char> buffer;
+
+  /// Scratch buffer for the compressed frame
+  std::vector<char> compressed;
+
+  /// Bytes of the staging buffer handed out so far
+  size_t bufferPos;
+
+  /// Total uncompressed bytes accounted to the caller
+  int64_t totalBytes;
+};
+
+/**
+ * A ZstdInputStream is a zero-copy input stream that decompresses a
+ * multi-frame Zstandard file with a pool of worker threads running
+ * ahead of the consumer. The file is mapped read-only, split on frame
+ * boundaries, and frames are decompressed out of order but handed to
+ * the consumer in order.
+ */
+class ZstdInputStream : public google::protobuf::io::ZeroCopyInputStream {
+ public:
+  /**
+   * Map the given file and start the decompression workers.
+   *
+   * @param filename Path to the multi-frame zstd file
+   * @param num_threads Number of decompression workers
+   */
+  ZstdInputStream(const std::string& filename, uint32_t num_threads = 4);
+
+  /**
+   * Stop the workers and unmap the file.
+   */
+  ~ZstdInputStream();
+
+  /**
+   * Check if the file was mapped and split successfully.
+   */
+  bool isOpen() const;
+
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  /// Worker body: decompress frames as they are claimed
+  void workerLoop();
+
+  /// Compressed file mapping
+  void* mapBase;
+  size_t mapSize;
+
+  /// (offset, compressed size) of every frame in the file
+  std::vector<std::pair<size_t, size_t>> frames;
+
+  /// Next frame index to be claimed by a worker
+  std::atomic<size_t> nextFrame;
+
+  /// How far ahead of the consumer workers may run, in frames
+  size_t maxAhead;
+
+  /// Decompressed frames waiting for the consumer, keyed by index
+  std::map<size_t, std::string> readyFrames;
+  std::mutex mutex;
+  std::condition_variable readyCv;
+  std::condition_variable aheadCv;
+  bool stop;
+
+  /// Consumer state: current frame and position within it
+  std::string currentFrame;
+  size_t currentPos;
+  size_t consumeIndex;
+  int64_t totalBytes;
+
+  std::vector<std::thread> workers;
+};
+
+#endif // __PROTO_ZSTDSTREAM_HH__
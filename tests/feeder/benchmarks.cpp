@@ -0,0 +1,218 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "WrapperNode.h"
+#include "et_feeder.h"
+
+// Benchmarks for the feeder hot paths: window load, issue/retire,
+// lookup, raw protobuf decode and the equivalent JSON-path operations.
+// Each benchmark is parameterized over the number of nodes so that
+// nodes/sec and bytes/sec can be compared across trace sizes.
+//
+// Traces are synthesized once per size and reused: a chain of COMP
+// nodes where node i depends on node i-1, which keeps the dep-free
+// queue busy and exercises child resolution on every retire.
+
+// Every file generated during the run, removed again by main()
+static std::vector<std::string> generated_files;
+
+// The feeder publishes a graph-cache sidecar after a complete load and
+// may drop an offset index next to the trace; remove them so every
+// construction measures the protobuf decode/link path, not the cache
+// load path
+static void removeSidecars(const std::string& filename) {
+  std::remove((filename + ".gcache").c_str());
+  std::remove((filename + ".gcache.tmp").c_str());
+  std::remove((filename + ".idx").c_str());
+}
+
+static std::string syntheticProtoTrace(int64_t num_nodes) {
+  static std::unordered_map<int64_t, std::string> cache;
+  auto it = cache.find(num_nodes);
+  if (it != cache.end())
+    return it->second;
+
+  std::string filename =
+      "benchmark_trace_" + std::to_string(num_nodes) + ".et";
+  {
+    ProtoOutputStream trace(filename);
+    ChakraProtoMsg::GlobalMetadata metadata;
+    metadata.set_version("0.0.4");
+    trace.write(metadata);
+
+    for (int64_t i = 1; i <= num_nodes; ++i) {
+      ChakraProtoMsg::Node node;
+      node.set_id(i);
+      node.set_name("COMP_NODE_" + std::to_string(i));
+      node.set_type(ChakraProtoMsg::COMP_NODE);
+      if (i > 1)
+        node.add_data_deps(i - 1);
+      ChakraProtoMsg::AttributeProto* attr = node.add_attr();
+      attr->set_name("is_cpu_op");
+      attr->set_bool_val(true);
+      attr = node.add_attr();
+      attr->set_name("num_ops");
+      attr->set_int64_val(1024);
+      trace.write(node);
+    }
+  }
+  cache[num_nodes] = filename;
+  generated_files.push_back(filename);
+  return filename;
+}
+
+static std::string syntheticJSONTrace(int64_t num_nodes) {
+  static std::unordered_map<int64_t, std::string> cache;
+  auto it = cache.find(num_nodes);
+  if (it != cache.end())
+    return it->second;
+
+  std::string filename =
+      "benchmark_trace_" + std::to_string(num_nodes) + ".json";
+  {
+    std::ofstream file(filename);
+    file << "{\"workload_graph\": [";
+    for (int64_t i = 1; i <= num_nodes; ++i) {
+      if (i > 1)
+        file << ",";
+      file << "{\"Id\": " << i << ", \"Name\": \"COMP_NODE_" << i
+           << "\", \"NodeType\": 4, \"is_cpu_op\": true, \"runtime\": 10"
+           << ", \"data_deps\": [";
+      if (i > 1)
+        file << (i - 1);
+      file << "]}";
+    }
+    file << "]}";
+  }
+  cache[num_nodes] = filename;
+  generated_files.push_back(filename);
+  return filename;
+}
+
+static int64_t fileSize(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  return file.tellg();
+}
+
+// Construction cost: global metadata read plus the first window load
+static void BM_ETFeederWindowLoad(benchmark::State& state) {
+  std::string filename = syntheticProtoTrace(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    removeSidecars(filename);
+    state.ResumeTiming();
+    Chakra::ETFeeder trace(filename);
+    benchmark::DoNotOptimize(trace.hasNodesToIssue());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ETFeederWindowLoad)->Arg(1 << 10)->Arg(1 << 13)->Arg(1 << 16);
+
+// Full replay: issue the lowest dep-free node, free its children and
+// retire it until the trace drains
+static void BM_ETFeederIssueRetire(benchmark::State& state) {
+  std::string filename = syntheticProtoTrace(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    removeSidecars(filename);
+    Chakra::ETFeeder trace(filename);
+    state.ResumeTiming();
+    while (trace.hasNodesToIssue()) {
+      std::shared_ptr<Chakra::ETFeederNode> node = trace.getNextIssuableNode();
+      if (node == nullptr)
+        break;
+      trace.freeChildrenNodes(node->id());
+      trace.removeNode(node->id());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ETFeederIssueRetire)->Arg(1 << 10)->Arg(1 << 13)->Arg(1 << 16);
+
+// Random-access lookups against a resident window
+static void BM_ETFeederLookupNode(benchmark::State& state) {
+  std::string filename = syntheticProtoTrace(state.range(0));
+  removeSidecars(filename);
+  Chakra::ETFeeder trace(filename);
+  uint64_t node_id = 1;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(trace.lookupNode(node_id));
+    node_id = (node_id % state.range(0)) + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ETFeederLookupNode)->Arg(1 << 10)->Arg(1 << 13)->Arg(1 << 16);
+
+// Raw decode throughput of the length-prefixed message stream,
+// without any graph bookkeeping
+static void BM_ProtoInputStreamDecode(benchmark::State& state) {
+  std::string filename = syntheticProtoTrace(state.range(0));
+  int64_t bytes = fileSize(filename);
+  for (auto _ : state) {
+    ProtoInputStream trace(filename);
+    ChakraProtoMsg::GlobalMetadata metadata;
+    trace.read(metadata);
+    ChakraProtoMsg::Node node;
+    while (trace.read(node)) {
+      benchmark::DoNotOptimize(node.id());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_ProtoInputStreamDecode)->Arg(1 << 10)->Arg(1 << 13)->Arg(1 << 16);
+
+// JSON-path equivalent of the window load: SAX parse plus linking of
+// the first window
+static void BM_WrapperNodeJSONWindowLoad(benchmark::State& state) {
+  std::string filename = syntheticJSONTrace(state.range(0));
+  for (auto _ : state) {
+    JSONWrapperNode wrapper;
+    wrapper.createWrapper(filename);
+    benchmark::DoNotOptimize(wrapper.hasNodesToIssue());
+    wrapper.releaseMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_WrapperNodeJSONWindowLoad)->Arg(1 << 10)->Arg(1 << 13)->Arg(1 << 16);
+
+// JSON-path equivalent of the issue/retire cycle
+static void BM_WrapperNodeJSONIssueRetire(benchmark::State& state) {
+  std::string filename = syntheticJSONTrace(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    JSONWrapperNode wrapper;
+    wrapper.createWrapper(filename);
+    state.ResumeTiming();
+    while (wrapper.hasNodesToIssue()) {
+      wrapper.getNextIssuableNode();
+      if (!wrapper.isValidNode())
+        break;
+      int64_t node_id = wrapper.getNodeID();
+      wrapper.freeChildrenNodes(node_id);
+      wrapper.removeNode(node_id);
+    }
+    state.PauseTiming();
+    wrapper.releaseMemory();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_WrapperNodeJSONIssueRetire)->Arg(1 << 10)->Arg(1 << 13)->Arg(1 << 16);
+
+// BENCHMARK_MAIN plus cleanup: the generated traces and any sidecars
+// the feeder dropped next to them must not outlive the run
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  for (const std::string& filename : generated_files) {
+    removeSidecars(filename);
+    std::remove(filename.c_str());
+  }
+  return 0;
+}
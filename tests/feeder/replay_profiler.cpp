@@ -0,0 +1,312 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "et_feeder.h"
+
+// Self-profiling replay driver: runs a trace through the full ETFeeder
+// issue/retire loop with no simulator attached and reports a per-phase
+// breakdown, so a feeder throughput drop can be bisected from one run
+// instead of by hand. The replay number is the feeder-only ceiling any
+// simulator integration can be compared against.
+//
+// Usage:
+//
+//   ./replay_profiler_bin <trace.et> [profile.json]
+//
+// Phases, each an isolated pass over the trace before the replay:
+//   raw_read  - ProtoInputStream::readRecord only (I/O + framing)
+//   decode    - readRecord plus protobuf Node parsing
+//   construct - decode plus ETFeederNode field extraction
+// then the full replay in issue/retire batches, and the feeder's own
+// cumulative internal timings (window read, resolveDep, queue
+// operations, freeChildrenNodes) from getStats().
+//
+// Output is chrome trace-event JSON (load it in chrome://tracing or
+// Perfetto, same format the timeline_visualizer emits); a per-phase
+// summary with bytes/sec and nodes/sec also goes to stdout. If a
+// .gcache sidecar exists the replay profiles the cache path instead of
+// the parse path; delete the sidecar to profile a cold parse.
+
+// One chrome trace-event row per phase; batch events within a phase
+// share its tid
+enum ProfileTid {
+  TID_RAW_READ = 0,
+  TID_DECODE = 1,
+  TID_CONSTRUCT = 2,
+  TID_REPLAY = 3,
+  TID_FEEDER_INTERNAL = 4,
+};
+
+struct TraceEvent {
+  int tid;
+  std::string name;
+  uint64_t ts_us;
+  uint64_t dur_us;
+  // Pre-rendered JSON object, e.g. {"bytes":123}; empty for none
+  std::string args_json;
+};
+
+class TraceEventLog {
+ public:
+  TraceEventLog() : start_(std::chrono::steady_clock::now()) {}
+
+  uint64_t nowUs() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start_)
+        .count();
+  }
+
+  void add(
+      int tid,
+      const std::string& name,
+      uint64_t ts_us,
+      uint64_t dur_us,
+      const std::string& args_json = "") {
+    events_.push_back(TraceEvent{tid, name, ts_us, dur_us, args_json});
+  }
+
+  void write(const std::string& filename) const {
+    static const struct {
+      int tid;
+      const char* name;
+    } thread_names[] = {
+        {TID_RAW_READ, "raw_read"},
+        {TID_DECODE, "decode"},
+        {TID_CONSTRUCT, "construct"},
+        {TID_REPLAY, "replay"},
+        {TID_FEEDER_INTERNAL, "feeder internal (cumulative)"},
+    };
+
+    std::ofstream out(filename);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& thread : thread_names) {
+      if (!first) {
+        out << ",";
+      }
+      first = false;
+      out << "{\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.tid
+          << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << thread.name
+          << "\"}}";
+    }
+    for (const TraceEvent& event : events_) {
+      out << ",{\"ph\":\"X\",\"pid\":0,\"tid\":" << event.tid << ",\"name\":\""
+          << event.name << "\",\"ts\":" << event.ts_us
+          << ",\"dur\":" << event.dur_us;
+      if (!event.args_json.empty()) {
+        out << ",\"args\":" << event.args_json;
+      }
+      out << "}";
+    }
+    out << "]}\n";
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+  std::vector<TraceEvent> events_;
+};
+
+static double perSec(uint64_t count, uint64_t dur_us) {
+  return (dur_us == 0) ? 0.0 : (count * 1e6 / dur_us);
+}
+
+// Phase 1: framing only — how fast the records come off the file
+static uint64_t profileRawRead(
+    const std::string& filename,
+    TraceEventLog& log) {
+  ProtoInputStream trace(filename);
+  std::string record;
+  uint64_t num_records = 0;
+  uint64_t num_bytes = 0;
+  uint64_t start = log.nowUs();
+  while (trace.readRecord(record)) {
+    ++num_records;
+    num_bytes += record.size();
+  }
+  uint64_t dur = log.nowUs() - start;
+  log.add(
+      TID_RAW_READ,
+      "raw_read",
+      start,
+      dur,
+      "{\"records\":" + std::to_string(num_records) +
+          ",\"bytes\":" + std::to_string(num_bytes) +
+          ",\"bytes_per_sec\":" + std::to_string(perSec(num_bytes, dur)) + "}");
+  printf(
+      "raw_read    %8.1f ms  %10.0f bytes/sec  (%lu records, %lu bytes)\n",
+      dur / 1e3,
+      perSec(num_bytes, dur),
+      (unsigned long)num_records,
+      (unsigned long)num_bytes);
+  return dur;
+}
+
+// Phase 2: framing plus protobuf parsing into one reused message
+static uint64_t profileDecode(
+    const std::string& filename,
+    TraceEventLog& log,
+    uint64_t raw_read_us) {
+  ProtoInputStream trace(filename);
+  ChakraProtoMsg::GlobalMetadata metadata;
+  trace.read(metadata);
+  ChakraProtoMsg::Node msg;
+  uint64_t num_nodes = 0;
+  uint64_t start = log.nowUs();
+  while (trace.read(msg)) {
+    ++num_nodes;
+  }
+  uint64_t dur = log.nowUs() - start;
+  uint64_t parse_us = (dur > raw_read_us) ? (dur - raw_read_us) : 0;
+  log.add(
+      TID_DECODE,
+      "decode",
+      start,
+      dur,
+      "{\"nodes\":" + std::to_string(num_nodes) +
+          ",\"nodes_per_sec\":" + std::to_string(perSec(num_nodes, dur)) +
+          ",\"parse_only_us\":" + std::to_string(parse_us) + "}");
+  printf(
+      "decode      %8.1f ms  %10.0f nodes/sec  (parse only: %.1f ms)\n",
+      dur / 1e3,
+      perSec(num_nodes, dur),
+      parse_us / 1e3);
+  return dur;
+}
+
+// Phase 3: decode plus ETFeederNode field extraction (interning,
+// attribute copies), the last step before graph insertion
+static void profileConstruct(
+    const std::string& filename,
+    TraceEventLog& log,
+    uint64_t decode_us) {
+  ProtoInputStream trace(filename);
+  ChakraProtoMsg::GlobalMetadata metadata;
+  trace.read(metadata);
+  std::shared_ptr<ChakraProtoMsg::Node> msg =
+      std::make_shared<ChakraProtoMsg::Node>();
+  Chakra::ETFeederNode scratch;
+  uint64_t num_nodes = 0;
+  uint64_t start = log.nowUs();
+  while (trace.read(*msg)) {
+    scratch.reinit(msg);
+    ++num_nodes;
+  }
+  uint64_t dur = log.nowUs() - start;
+  uint64_t extract_us = (dur > decode_us) ? (dur - decode_us) : 0;
+  log.add(
+      TID_CONSTRUCT,
+      "construct",
+      start,
+      dur,
+      "{\"nodes\":" + std::to_string(num_nodes) +
+          ",\"nodes_per_sec\":" + std::to_string(perSec(num_nodes, dur)) +
+          ",\"extract_only_us\":" + std::to_string(extract_us) + "}");
+  printf(
+      "construct   %8.1f ms  %10.0f nodes/sec  (extract only: %.1f ms)\n",
+      dur / 1e3,
+      perSec(num_nodes, dur),
+      extract_us / 1e3);
+}
+
+// Phase 4: the real thing — full feeder replay in issue/retire
+// batches, one trace event per batch, then the feeder's own cumulative
+// phase timings laid alongside
+static uint64_t profileReplay(const std::string& filename, TraceEventLog& log) {
+  uint64_t construct_start = log.nowUs();
+  Chakra::ETFeeder feeder(filename);
+  log.add(
+      TID_REPLAY, "feeder_construct", construct_start,
+      log.nowUs() - construct_start);
+
+  std::vector<std::shared_ptr<Chakra::ETFeederNode>> batch;
+  std::vector<uint64_t> batch_ids;
+  uint64_t num_retired = 0;
+  uint64_t replay_start = log.nowUs();
+  while (feeder.hasNodesToIssue()) {
+    uint64_t issue_start = log.nowUs();
+    uint64_t num_issued = feeder.getNextIssuableNodes(256, batch);
+    uint64_t issue_end = log.nowUs();
+    if (num_issued == 0) {
+      break;
+    }
+    batch_ids.clear();
+    for (const auto& node : batch) {
+      batch_ids.push_back(node->id());
+    }
+    batch.clear();
+    feeder.retireNodes(batch_ids);
+    num_retired += num_issued;
+    log.add(
+        TID_REPLAY, "issue_batch", issue_start, issue_end - issue_start,
+        "{\"nodes\":" + std::to_string(num_issued) + "}");
+    log.add(
+        TID_REPLAY, "retire_batch", issue_end, log.nowUs() - issue_end,
+        "{\"nodes\":" + std::to_string(num_issued) + "}");
+  }
+  uint64_t replay_us = log.nowUs() - replay_start;
+
+  // The feeder's internal accounting covers the phases the driver
+  // cannot see from outside; cumulative, rendered as one span each
+  Chakra::ETFeederStats stats = feeder.getStats();
+  log.add(
+      TID_FEEDER_INTERNAL, "read_window", replay_start,
+      stats.read_window_time_us,
+      "{\"window_refills\":" + std::to_string(stats.window_refills) +
+          ",\"refill_stalls\":" + std::to_string(stats.window_refill_stalls) +
+          "}");
+  log.add(
+      TID_FEEDER_INTERNAL, "resolve_dep", replay_start,
+      stats.resolve_dep_time_us,
+      "{\"queue_high_watermark\":" +
+          std::to_string(stats.dep_free_queue_high_watermark) + "}");
+  log.add(
+      TID_FEEDER_INTERNAL, "free_children", replay_start,
+      stats.free_children_time_us);
+  log.add(
+      TID_REPLAY, "replay", replay_start, replay_us,
+      "{\"nodes_read\":" + std::to_string(stats.nodes_read) +
+          ",\"nodes_retired\":" + std::to_string(num_retired) +
+          ",\"nodes_per_sec\":" + std::to_string(perSec(num_retired, replay_us)) +
+          "}");
+
+  printf(
+      "replay      %8.1f ms  %10.0f nodes/sec  (%lu nodes; the feeder-only ceiling)\n",
+      replay_us / 1e3,
+      perSec(num_retired, replay_us),
+      (unsigned long)num_retired);
+  printf(
+      "  internal: read_window %.1f ms, resolve_dep %.1f ms, free_children %.1f ms\n",
+      stats.read_window_time_us / 1e3,
+      stats.resolve_dep_time_us / 1e3,
+      stats.free_children_time_us / 1e3);
+  return num_retired;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <trace.et> [profile.json]\n", argv[0]);
+    return 1;
+  }
+  std::string trace_filename = argv[1];
+  std::string output_filename =
+      (argc > 2) ? argv[2] : "replay_profile.json";
+
+  TraceEventLog log;
+  uint64_t raw_read_us = profileRawRead(trace_filename, log);
+  uint64_t decode_us = profileDecode(trace_filename, log, raw_read_us);
+  profileConstruct(trace_filename, log, decode_us);
+  uint64_t num_retired = profileReplay(trace_filename, log);
+  if (num_retired == 0) {
+    fprintf(stderr, "replay retired no nodes; is the trace empty?\n");
+    return 1;
+  }
+
+  log.write(output_filename);
+  printf("wrote %s\n", output_filename.c_str());
+  return 0;
+}
@@ -0,0 +1,227 @@
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "WrapperNode.h"
+#include "et_feeder.h"
+
+// Stress harness for the feeder: generates large synthetic traces and
+// replays them end to end with assertions on wall-clock time and peak
+// RSS, so scalability regressions (quadratic dependency resolution,
+// unbounded window growth) fail the gate instead of surfacing in
+// production.
+//
+// The checked-in fixtures in tests.cpp stay small; this binary defaults
+// to a one-million-node graph and scales through the environment:
+//
+//   CHAKRA_STRESS_NODES=100000000 ./stress_bin
+//
+// is the full acceptance run before deploying a new feeder build. The
+// time and memory budgets scale with the node count.
+
+// Shape of a generated trace. Dependencies always point backwards and
+// at most max_dep_distance ids away, mirroring the locality of real
+// traces and keeping parents resident across window refills.
+struct SyntheticTraceParams {
+  int64_t num_nodes;
+  // Data dependencies drawn per node (duplicates are dropped, so the
+  // effective fan-out can be slightly lower)
+  int fanout;
+  // Dependency distances are uniform in [1, max_dep_distance]
+  int64_t max_dep_distance;
+  // Size of an opaque string attribute attached to every node, to
+  // model the attr payloads real traces carry
+  int attr_payload_bytes;
+  uint64_t seed;
+};
+
+static void generateSyntheticTrace(
+    const std::string& filename,
+    const SyntheticTraceParams& params) {
+  ProtoOutputStream trace(filename);
+  ChakraProtoMsg::GlobalMetadata metadata;
+  metadata.set_version("0.0.4");
+  trace.write(metadata);
+
+  std::mt19937_64 rng(params.seed);
+  std::string payload(params.attr_payload_bytes, 'x');
+  for (int64_t i = 1; i <= params.num_nodes; ++i) {
+    ChakraProtoMsg::Node node;
+    node.set_id(i);
+    node.set_name("STRESS_NODE_" + std::to_string(i));
+    node.set_type(ChakraProtoMsg::COMP_NODE);
+    int64_t max_distance = std::min<int64_t>(params.max_dep_distance, i - 1);
+    if (max_distance > 0) {
+      std::uniform_int_distribution<int64_t> dist(1, max_distance);
+      for (int d = 0; d < params.fanout; ++d) {
+        int64_t dep = i - dist(rng);
+        bool duplicate = false;
+        for (int j = 0; j < node.data_deps_size(); ++j) {
+          if (node.data_deps(j) == dep) {
+            duplicate = true;
+            break;
+          }
+        }
+        if (!duplicate) {
+          node.add_data_deps(dep);
+        }
+      }
+    }
+    ChakraProtoMsg::AttributeProto* attr = node.add_attr();
+    attr->set_name("is_cpu_op");
+    attr->set_bool_val(true);
+    attr = node.add_attr();
+    attr->set_name("num_ops");
+    attr->set_int64_val(1024);
+    if (params.attr_payload_bytes > 0) {
+      attr = node.add_attr();
+      attr->set_name("payload");
+      attr->set_string_val(payload);
+    }
+    trace.write(node);
+  }
+}
+
+static int64_t stressNodeCount() {
+  const char* env = std::getenv("CHAKRA_STRESS_NODES");
+  if (env != nullptr) {
+    return std::atoll(env);
+  }
+  return int64_t(1) << 20;
+}
+
+static uint64_t peakRssBytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // ru_maxrss is in KiB on Linux
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+static uint64_t elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Budgets, deliberately loose: the gate is meant to catch order-of-
+// magnitude regressions (quadratic blowups, leaks), not small
+// percentage slowdowns — the benchmarks track those
+static const uint64_t kMaxMicrosPerNode = 60;
+static const uint64_t kMinWallBudgetMs = 60 * 1000;
+// Only one window (4096 * 256 nodes) is resident at a time, so the
+// memory budget is flat in the trace size beyond that
+static const uint64_t kMaxRssBytes = uint64_t(6) << 30;
+
+static uint64_t wallBudgetMs(int64_t num_nodes) {
+  uint64_t budget = (uint64_t(num_nodes) * kMaxMicrosPerNode) / 1000;
+  return budget < kMinWallBudgetMs ? kMinWallBudgetMs : budget;
+}
+
+class FeederStressTest : public ::testing::Test {
+ protected:
+  // Generated once and shared by every test in the run; removed by the
+  // environment teardown below
+  static std::string traceFile() {
+    static std::string filename;
+    if (filename.empty()) {
+      SyntheticTraceParams params;
+      params.num_nodes = stressNodeCount();
+      params.fanout = 3;
+      params.max_dep_distance = 64;
+      params.attr_payload_bytes = 64;
+      params.seed = 42;
+      filename = "stress_trace_" + std::to_string(params.num_nodes) + ".et";
+      generateSyntheticTrace(filename, params);
+    }
+    return filename;
+  }
+};
+
+// Removes the generated trace and its sidecars once the run finishes
+class StressFileCleanup : public ::testing::Environment {
+ public:
+  explicit StressFileCleanup(std::string filename)
+      : filename_(std::move(filename)) {}
+  void TearDown() override {
+    std::remove(filename_.c_str());
+    std::remove((filename_ + ".idx").c_str());
+    std::remove((filename_ + ".gcache").c_str());
+    std::remove((filename_ + ".gcache.tmp").c_str());
+  }
+
+ private:
+  const std::string filename_;
+};
+
+TEST_F(FeederStressTest, ETFeederReplay) {
+  int64_t num_nodes = stressNodeCount();
+  std::string filename = traceFile();
+
+  auto start = std::chrono::steady_clock::now();
+  Chakra::ETFeeder trace(filename);
+  int64_t retired = 0;
+  std::vector<std::shared_ptr<Chakra::ETFeederNode>> batch;
+  std::vector<uint64_t> batch_ids;
+  while (trace.hasNodesToIssue()) {
+    uint64_t popped = trace.getNextIssuableNodes(256, batch);
+    if (popped == 0) {
+      break;
+    }
+    batch_ids.clear();
+    for (auto& node : batch) {
+      batch_ids.push_back(node->id());
+    }
+    batch.clear();
+    trace.retireNodes(batch_ids);
+    retired += popped;
+  }
+  uint64_t wall_ms = elapsedMs(start);
+
+  ASSERT_EQ(retired, num_nodes);
+  EXPECT_LE(wall_ms, wallBudgetMs(num_nodes));
+  EXPECT_LE(peakRssBytes(), kMaxRssBytes);
+
+  Chakra::ETFeederStats stats = trace.getStats();
+  ASSERT_EQ(stats.nodes_retired, static_cast<uint64_t>(num_nodes));
+}
+
+TEST_F(FeederStressTest, WrapperNodeReplay) {
+  // Same replay through the wrapper layer the simulators use; the
+  // trace's graph cache from the previous test is picked up if it was
+  // published, which is exactly what a redeploy would see
+  int64_t num_nodes = stressNodeCount();
+  std::string filename = traceFile();
+
+  auto start = std::chrono::steady_clock::now();
+  ProtobufWrapperNode wrapper;
+  wrapper.createWrapper(filename);
+  int64_t retired = 0;
+  while (wrapper.hasNodesToIssue()) {
+    wrapper.getNextIssuableNode();
+    if (!wrapper.isValidNode()) {
+      break;
+    }
+    int64_t node_id = wrapper.getNodeID();
+    wrapper.freeChildrenNodes(node_id);
+    wrapper.removeNode(node_id);
+    ++retired;
+  }
+  uint64_t wall_ms = elapsedMs(start);
+  wrapper.releaseMemory();
+
+  ASSERT_EQ(retired, num_nodes);
+  EXPECT_LE(wall_ms, wallBudgetMs(num_nodes));
+  EXPECT_LE(peakRssBytes(), kMaxRssBytes);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  ::testing::AddGlobalTestEnvironment(new StressFileCleanup(
+      "stress_trace_" + std::to_string(stressNodeCount()) + ".et"));
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,10 @@
+#include <cstdio>
+#include <sstream>
+
 #include <gtest/gtest.h>
 #include "et_feeder.h"
+#include "lookahead.h"
+#include "shared_trace.h"
 
 class ETFeederTest : public ::testing::Test {
  protected:
@@ -12,6 +17,14 @@ class ETFeederTest : public ::testing::Test {
 
   virtual void TearDown() {
     delete trace;
+    // The feeder leaves a graph-cache sidecar next to the fixture on a
+    // complete load; remove it so every test exercises the parse path
+    // it was written against and a run leaves the tree clean
+    std::remove("tests/data/chakra.0.et.gcache");
+    std::remove("tests/data/chakra.0.et.gcache.tmp");
+    // Likewise for the offset index, so lookupNodeFromTrace always
+    // exercises buildIndex instead of reusing an earlier run's sidecar
+    std::remove("tests/data/chakra.0.et.idx");
   }
 
   Chakra::ETFeeder* trace;
@@ -123,6 +136,15 @@ TEST_F(ETFeederTest, AddNodeTest) {
   ASSERT_EQ(node2->id(), 216);
 }
 
+TEST_F(ETFeederTest, LookupNodeFromTraceTest) {
+  SetUp("tests/data/chakra.0.et");
+  trace->removeNode(216);
+  std::shared_ptr<Chakra::ETFeederNode> node = trace->lookupNodeFromTrace(216);
+  ASSERT_EQ(node->id(), 216);
+  node = trace->getNextIssuableNode();
+  ASSERT_EQ(node->id(), 216);
+}
+
 TEST_F(ETFeederTest, NodeGetChildrenTest) {
   SetUp("tests/data/chakra.0.et");
   std::shared_ptr<Chakra::ETFeederNode> node;
@@ -137,3 +159,310 @@ int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
 }
+
+TEST_F(ETFeederTest, StatsTest) {
+  SetUp("tests/data/chakra.0.et");
+  std::shared_ptr<Chakra::ETFeederNode> node = trace->getNextIssuableNode();
+  trace->freeChildrenNodes(node->id());
+  trace->removeNode(node->id());
+  Chakra::ETFeederStats stats = trace->getStats();
+  ASSERT_EQ(stats.nodes_read, 3664);
+  ASSERT_EQ(stats.nodes_issued, 1);
+  ASSERT_EQ(stats.nodes_retired, 1);
+  ASSERT_EQ(stats.window_refills, 1);
+  ASSERT_GE(stats.dep_free_queue_high_watermark, 1);
+}
+
+TEST_F(ETFeederTest, BatchIssueRetireTest) {
+  SetUp("tests/data/chakra.0.et");
+  std::vector<std::shared_ptr<Chakra::ETFeederNode>> batch;
+  uint64_t num_issued = trace->getNextIssuableNodes(2, batch);
+  ASSERT_EQ(num_issued, 2);
+  ASSERT_EQ(batch[0]->id(), 216);
+  ASSERT_EQ(batch[1]->id(), 432);
+
+  trace->retireNodes({216, 432});
+  freopen("/dev/null", "w", stderr);
+  try {
+    trace->lookupNode(216);
+    ASSERT_TRUE(false) << "node should be retired \n";
+  } catch (const std::exception& e) {
+    // this is the desired behaviour
+  }
+  freopen("/dev/tty", "w", stderr);
+
+  std::shared_ptr<Chakra::ETFeederNode> node = trace->getNextIssuableNode();
+  ASSERT_EQ(node->id(), 217);
+}
+
+TEST_F(ETFeederTest, GraphCacheTest) {
+  std::remove("tests/data/chakra.0.et.gcache");
+
+  // First open parses the trace to completion and publishes the cache
+  std::vector<uint64_t> first_order;
+  SetUp("tests/data/chakra.0.et");
+  while (trace->hasNodesToIssue()) {
+    std::shared_ptr<Chakra::ETFeederNode> node = trace->getNextIssuableNode();
+    if (node == nullptr) {
+      break;
+    }
+    first_order.push_back(node->id());
+    trace->freeChildrenNodes(node->id());
+    trace->removeNode(node->id());
+  }
+  // Close the feeder without TearDown, which would also remove the
+  // cache the second open is meant to load
+  delete trace;
+  ASSERT_EQ(first_order.size(), 3664);
+  std::ifstream cache_file("tests/data/chakra.0.et.gcache", std::ios::binary);
+  ASSERT_TRUE(cache_file.good());
+
+  // Second open loads the cache; the replay must be indistinguishable
+  SetUp("tests/data/chakra.0.et");
+  std::shared_ptr<Chakra::ETFeederNode> node = trace->lookupNode(216);
+  ASSERT_EQ(node->type(), ChakraProtoMsg::COMP_NODE);
+  ASSERT_TRUE(node->is_cpu_op());
+  ASSERT_EQ(node->get_other_attr("rf_id").int64_val(), 2);
+
+  std::vector<uint64_t> second_order;
+  while (trace->hasNodesToIssue()) {
+    node = trace->getNextIssuableNode();
+    if (node == nullptr) {
+      break;
+    }
+    second_order.push_back(node->id());
+    trace->freeChildrenNodes(node->id());
+    trace->removeNode(node->id());
+  }
+  ASSERT_EQ(second_order, first_order);
+}
+
+TEST_F(ETFeederTest, SnapshotRestoreTest) {
+  SetUp("tests/data/chakra.0.et");
+  for (int i = 0; i < 100; ++i) {
+    std::shared_ptr<Chakra::ETFeederNode> node = trace->getNextIssuableNode();
+    ASSERT_NE(node, nullptr);
+    trace->freeChildrenNodes(node->id());
+    trace->removeNode(node->id());
+  }
+
+  std::stringstream checkpoint;
+  trace->snapshot(checkpoint);
+
+  // Finish the original run to get the reference issue order
+  std::vector<uint64_t> expected_order;
+  while (trace->hasNodesToIssue()) {
+    std::shared_ptr<Chakra::ETFeederNode> node = trace->getNextIssuableNode();
+    if (node == nullptr) {
+      break;
+    }
+    expected_order.push_back(node->id());
+    trace->freeChildrenNodes(node->id());
+    trace->removeNode(node->id());
+  }
+  ASSERT_EQ(expected_order.size(), 3564);
+  TearDown();
+
+  // A fresh feeder restored from the checkpoint must continue exactly
+  // where the original left off
+  SetUp("tests/data/chakra.0.et");
+  ASSERT_TRUE(trace->restore(checkpoint));
+  std::vector<uint64_t> resumed_order;
+  while (trace->hasNodesToIssue()) {
+    std::shared_ptr<Chakra::ETFeederNode> node = trace->getNextIssuableNode();
+    if (node == nullptr) {
+      break;
+    }
+    resumed_order.push_back(node->id());
+    trace->freeChildrenNodes(node->id());
+    trace->removeNode(node->id());
+  }
+  ASSERT_EQ(resumed_order, expected_order);
+}
+
+TEST_F(ETFeederTest, NodeFilterTest) {
+  // Reference pass: record every node's dependencies and whether the
+  // filter would keep it
+  SetUp("tests/data/chakra.0.et");
+  std::unordered_map<uint64_t, std::vector<uint64_t>> deps;
+  std::unordered_map<uint64_t, bool> kept;
+  uint64_t num_kept = 0;
+  while (trace->hasNodesToIssue()) {
+    std::shared_ptr<Chakra::ETFeederNode> node = trace->getNextIssuableNode();
+    if (node == nullptr) {
+      break;
+    }
+    deps[node->id()] = node->data_deps();
+    kept[node->id()] = !node->is_cpu_op();
+    if (kept[node->id()]) {
+      ++num_kept;
+    }
+    trace->freeChildrenNodes(node->id());
+    trace->removeNode(node->id());
+  }
+  ASSERT_EQ(deps.size(), 3664);
+  ASSERT_GT(num_kept, 0);
+  ASSERT_LT(num_kept, deps.size());
+  TearDown();
+
+  // Filtered pass: only nodes passing the predicate may issue, and
+  // each one only after all of its retained ancestors retired, so the
+  // rewired subgraph preserves the original ordering
+  trace = new Chakra::ETFeeder(
+      "tests/data/chakra.0.et",
+      true,
+      [](Chakra::ETFeederNode& node) { return !node.is_cpu_op(); });
+  std::unordered_set<uint64_t> retired;
+  while (trace->hasNodesToIssue()) {
+    std::shared_ptr<Chakra::ETFeederNode> node = trace->getNextIssuableNode();
+    if (node == nullptr) {
+      break;
+    }
+    ASSERT_TRUE(kept[node->id()]);
+    // Walk the original dependencies, expanding dropped nodes into
+    // their own dependencies, and check every retained ancestor
+    std::vector<uint64_t> work = deps[node->id()];
+    std::unordered_set<uint64_t> visited;
+    while (!work.empty()) {
+      uint64_t dep_id = work.back();
+      work.pop_back();
+      if (!visited.insert(dep_id).second) {
+        continue;
+      }
+      if (kept[dep_id]) {
+        ASSERT_EQ(retired.count(dep_id), 1);
+      } else {
+        const std::vector<uint64_t>& parent_deps = deps[dep_id];
+        work.insert(work.end(), parent_deps.begin(), parent_deps.end());
+      }
+    }
+    retired.emplace(node->id());
+    trace->freeChildrenNodes(node->id());
+    trace->removeNode(node->id());
+  }
+  ASSERT_EQ(retired.size(), num_kept);
+
+  Chakra::ETFeederStats stats = trace->getStats();
+  ASSERT_EQ(stats.nodes_read, num_kept);
+  ASSERT_EQ(stats.nodes_filtered, deps.size() - num_kept);
+}
+
+TEST_F(ETFeederTest, SharedTraceFeederTest) {
+  // Reference pass: a regular feeder's issue order over the trace
+  SetUp("tests/data/chakra.0.et");
+  std::vector<uint64_t> expected_order;
+  while (trace->hasNodesToIssue()) {
+    std::shared_ptr<Chakra::ETFeederNode> node = trace->getNextIssuableNode();
+    if (node == nullptr) {
+      break;
+    }
+    expected_order.push_back(node->id());
+    trace->freeChildrenNodes(node->id());
+    trace->removeNode(node->id());
+  }
+  ASSERT_EQ(expected_order.size(), 3664);
+
+  // Two opens of the same trace share one decoded store
+  std::shared_ptr<Chakra::SharedTraceStore> store =
+      Chakra::SharedTraceStore::open("tests/data/chakra.0.et");
+  std::shared_ptr<Chakra::SharedTraceStore> again =
+      Chakra::SharedTraceStore::open("tests/data/chakra.0.et");
+  ASSERT_EQ(store.get(), again.get());
+  ASSERT_EQ(store->numNodes(), 3664);
+
+  // Two replicated ranks over the shared store replay independently;
+  // each must reproduce the reference order despite sharing every node
+  // object with the other
+  Chakra::SharedTraceFeeder rank0(store);
+  Chakra::SharedTraceFeeder rank1(store);
+  for (Chakra::SharedTraceFeeder* rank : {&rank0, &rank1}) {
+    std::vector<uint64_t> order;
+    while (rank->hasNodesToIssue()) {
+      std::shared_ptr<Chakra::ETFeederNode> node = rank->getNextIssuableNode();
+      if (node == nullptr) {
+        break;
+      }
+      order.push_back(node->id());
+      rank->freeChildrenNodes(node->id());
+      rank->removeNode(node->id());
+    }
+    ASSERT_EQ(order, expected_order);
+  }
+}
+
+TEST_F(ETFeederTest, LookaheadScannerTest) {
+  // The fixture fits in one window, so the feeder holds every node
+  // fully materialized to check the scanner's compact records against
+  SetUp("tests/data/chakra.0.et");
+  Chakra::LookaheadScanner scanner("tests/data/chakra.0.et");
+
+  std::vector<Chakra::LookaheadRecord> records;
+  ASSERT_EQ(scanner.peek(4096, records), 3664);
+  uint64_t expected_comm_nodes = 0;
+  uint64_t expected_comm_size = 0;
+  uint64_t expected_runtime = 0;
+  for (const Chakra::LookaheadRecord& record : records) {
+    std::shared_ptr<Chakra::ETFeederNode> node = trace->lookupNode(record.id);
+    ASSERT_EQ(record.type, node->type());
+    ASSERT_EQ(record.runtime, node->runtime());
+    ASSERT_EQ(record.comm_size, node->comm_size());
+    expected_runtime += record.runtime;
+    if ((record.type == ChakraProtoMsg::COMM_SEND_NODE) ||
+        (record.type == ChakraProtoMsg::COMM_RECV_NODE) ||
+        (record.type == ChakraProtoMsg::COMM_COLL_NODE)) {
+      ++expected_comm_nodes;
+      expected_comm_size += record.comm_size;
+    }
+  }
+  ASSERT_EQ(expected_comm_nodes, 21);
+
+  Chakra::LookaheadSummary summary = scanner.summarize(4096);
+  ASSERT_EQ(summary.num_nodes, 3664);
+  ASSERT_EQ(summary.num_comm_nodes, expected_comm_nodes);
+  ASSERT_EQ(summary.total_comm_size, expected_comm_size);
+  ASSERT_EQ(summary.total_runtime, expected_runtime);
+
+  // Advancing past the first record drops exactly that record
+  scanner.advanceTo(records[0].end_offset);
+  std::vector<Chakra::LookaheadRecord> rest;
+  ASSERT_EQ(scanner.peek(4096, rest), 3663);
+  ASSERT_EQ(rest[0].id, records[1].id);
+
+  // Syncing to the last record's end offset exhausts the scanner; the
+  // feeder's consumed offset never points past it
+  ASSERT_LE(trace->consumedOffset(), records.back().end_offset);
+  scanner.advanceTo(records.back().end_offset);
+  ASSERT_EQ(scanner.peek(16, rest), 0);
+}
+
+TEST_F(ETFeederTest, MmapWindowSlideTest) {
+  trace = nullptr;
+
+  // Count records with the default window, which covers the whole
+  // fixture in one span
+  uint64_t default_records = 0;
+  {
+    ProtoInputStream stream("tests/data/chakra.0.et");
+    std::string record;
+    while (stream.readRecord(record)) {
+      ++default_records;
+    }
+  }
+  ASSERT_EQ(default_records, 3665);
+
+  // A window far smaller than the file stands in for a >2GB mapping,
+  // whose size does not fit the array stream's int constructor; every
+  // few reads must now slide the window and none may be lost
+  uint64_t saved_limit = ProtoInputStream::mmapWindowLimit;
+  ProtoInputStream::mmapWindowLimit = 1 << 16;
+  uint64_t windowed_records = 0;
+  {
+    ProtoInputStream stream("tests/data/chakra.0.et");
+    std::string record;
+    while (stream.readRecord(record)) {
+      ++windowed_records;
+    }
+  }
+  ProtoInputStream::mmapWindowLimit = saved_limit;
+  ASSERT_EQ(windowed_records, default_records);
+}